@@ -0,0 +1,222 @@
+#include "control_server.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "sockets.hpp"
+
+// How often new states are looked for
+static constexpr const int pollIntervalMs = 50;
+
+static constexpr const int maxClients = 8;
+// Longer lines (without a newline) get the client disconnected
+static constexpr const size_t maxLineLength = 4096;
+
+ControlServer::~ControlServer()
+{
+	stop();
+}
+
+bool ControlServer::start(const std::string &path, CommandHandler commandHandler, StateRenderer stateRenderer)
+{
+	stop();
+
+	sockaddr_un address = {};
+	if (path.size() >= sizeof(address.sun_path))
+		return false;
+	address.sun_family = AF_UNIX;
+	std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+	if (!initSockets())
+		return false;
+
+	Socket listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener == INVALID_SOCKET)
+	{
+		cleanupSockets();
+		return false;
+	}
+
+	// Left behind if OVRDR didn't quit cleanly
+	std::remove(path.c_str());
+	if (bind(listener, (sockaddr *)&address, sizeof(address)) != 0 || listen(listener, maxClients) != 0 || !setSocketNonBlocking(listener))
+	{
+		closeSocket(listener);
+		cleanupSockets();
+		return false;
+	}
+
+	listenSocket = (intptr_t)listener;
+	this->path = path;
+	this->commandHandler = commandHandler;
+	this->stateRenderer = stateRenderer;
+	state.clear();
+	clients.reserve(maxClients);
+	quit = false;
+	thread = std::thread(&ControlServer::serve, this);
+	return true;
+}
+
+void ControlServer::stop()
+{
+	if (listenSocket == -1)
+		return;
+
+	quit = true;
+	if (thread.joinable())
+		thread.join();
+
+	for (Client &client : clients)
+		closeSocket((Socket)client.socket);
+	clients.clear();
+	closeSocket((Socket)listenSocket);
+	listenSocket = -1;
+	std::remove(path.c_str());
+	cleanupSockets();
+}
+
+void ControlServer::serve()
+{
+	Socket listener = (Socket)listenSocket;
+	while (!quit)
+	{
+		// Stream new states
+		if (stateRenderer(state))
+		{
+			for (Client &client : clients)
+			{
+				if (client.subscribed)
+					sendLine(client, state);
+			}
+		}
+
+		// Wait for connections and commands (or the next state)
+		fd_set readSet;
+		FD_ZERO(&readSet);
+		FD_SET(listener, &readSet);
+		Socket maxSocket = listener;
+		for (const Client &client : clients)
+		{
+			FD_SET((Socket)client.socket, &readSet);
+			maxSocket = std::max(maxSocket, (Socket)client.socket);
+		}
+		timeval timeout = {0, pollIntervalMs * 1000};
+		if (select((int)maxSocket + 1, &readSet, nullptr, nullptr, &timeout) <= 0)
+			continue;
+
+		for (Client &client : clients)
+		{
+			if (FD_ISSET((Socket)client.socket, &readSet))
+				receive(client);
+		}
+
+		if (FD_ISSET(listener, &readSet))
+		{
+			Socket socket = accept(listener, nullptr, nullptr);
+			if (socket != INVALID_SOCKET)
+			{
+				if (clients.size() < (size_t)maxClients && setSocketNonBlocking(socket))
+				{
+					Client client;
+					client.socket = (intptr_t)socket;
+					clients.push_back(client);
+				}
+				else
+				{
+					closeSocket(socket);
+				}
+			}
+		}
+
+		// Forget disconnected clients
+		for (Client &client : clients)
+		{
+			if (client.closed)
+				closeSocket((Socket)client.socket);
+		}
+		clients.erase(std::remove_if(clients.begin(), clients.end(), [](const Client &client)
+									 { return client.closed; }),
+					  clients.end());
+	}
+}
+
+void ControlServer::receive(Client &client)
+{
+	char buffer[1024];
+	int received = recv((Socket)client.socket, buffer, sizeof(buffer), 0);
+	if (received <= 0)
+	{
+		client.closed = true;
+		return;
+	}
+	client.input.append(buffer, received);
+
+	// Run every complete line
+	size_t lineStart = 0;
+	size_t lineEnd;
+	while (!client.closed && (lineEnd = client.input.find('\n', lineStart)) != std::string::npos)
+	{
+		handleLine(client, client.input.substr(lineStart, lineEnd - lineStart));
+		lineStart = lineEnd + 1;
+	}
+	client.input.erase(0, lineStart);
+
+	if (client.input.size() > maxLineLength)
+		client.closed = true;
+}
+
+void ControlServer::handleLine(Client &client, const std::string &line)
+{
+	response.clear();
+	bool first = true;
+	for (size_t start = 0; start <= line.size();)
+	{
+		size_t end = std::min(line.find(';', start), line.size());
+
+		// Trim spaces (and the \r of \r\n)
+		size_t commandStart = line.find_first_not_of(" \t\r", start);
+		size_t commandEnd = line.find_last_not_of(" \t\r", end - 1);
+		start = end + 1;
+		if (commandStart >= end || commandEnd == std::string::npos || commandEnd < commandStart)
+			continue;
+		std::string command = line.substr(commandStart, commandEnd - commandStart + 1);
+
+		if (!first)
+			response += "; ";
+		first = false;
+
+		if (command == "get")
+		{
+			response += state.empty() ? "error no state yet" : state;
+		}
+		else if (command == "subscribe")
+		{
+			client.subscribed = true;
+			response += "ok";
+		}
+		else if (command == "unsubscribe")
+		{
+			client.subscribed = false;
+			response += "ok";
+		}
+		else
+		{
+			commandHandler(command, response);
+		}
+	}
+
+	// Empty lines get nothing back
+	if (!first)
+		sendLine(client, response);
+}
+
+void ControlServer::sendLine(Client &client, const std::string &line)
+{
+	// Clients that don't read what they're sent get disconnected rather than holding up the server
+	output.assign(line);
+	output += '\n';
+	int sent = send((Socket)client.socket, output.data(), (int)output.size(), MSG_NOSIGNAL);
+	if (sent != (int)output.size())
+		client.closed = true;
+}
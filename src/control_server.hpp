@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Local control API, served from its own thread on a Unix domain socket.
+ *
+ * Clients send lines of commands separated by ';' and get one line back per line sent,
+ * with the response of each command separated by "; " ("ok", "error <reason>" or "state <key>=<value> ...").
+ * The server handles:
+ *   get          the latest state line
+ *   subscribe    also sends every new state line as it comes (until unsubscribe)
+ *   unsubscribe
+ * Every other command is passed to the command handler.
+ */
+class ControlServer
+{
+public:
+	/// Runs a command (without its ';'), appending its response (without a newline)
+	using CommandHandler = std::function<void(const std::string &command, std::string &response)>;
+	/// Re-renders the state line (cleared by the renderer, without a newline) if there's a new state, returns false otherwise
+	using StateRenderer = std::function<bool(std::string &state)>;
+
+	ControlServer() = default;
+	ControlServer(const ControlServer &) = delete;
+	ControlServer &operator=(const ControlServer &) = delete;
+	~ControlServer();
+
+	/// Starts listening on the socket at path (replacing a stale one), returns false if it can't be created
+	bool start(const std::string &path, CommandHandler commandHandler, StateRenderer stateRenderer);
+	void stop();
+
+private:
+	struct Client
+	{
+		// SOCKET on Windows, file descriptor elsewhere
+		intptr_t socket = -1;
+		// Received text without a newline yet
+		std::string input;
+		bool subscribed = false;
+		bool closed = false;
+	};
+
+	void serve();
+	void receive(Client &client);
+	void handleLine(Client &client, const std::string &line);
+	void sendLine(Client &client, const std::string &line);
+
+	CommandHandler commandHandler;
+	StateRenderer stateRenderer;
+	std::string path;
+	std::string state;
+	std::string response;
+	std::string output;
+	std::vector<Client> clients;
+
+	intptr_t listenSocket = -1;
+	std::thread thread;
+	std::atomic<bool> quit{false};
+};
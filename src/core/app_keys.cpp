@@ -0,0 +1,60 @@
+#include "app_keys.hpp"
+
+AppKeys::AppKeys()
+{
+	intern("");
+}
+
+int AppKeys::intern(const std::string &appKey)
+{
+	auto it = ids.find(appKey);
+	if (it != ids.end())
+		return it->second;
+
+	int appId = (int)keys.size();
+	ids.emplace(appKey, appId);
+	keys.push_back(appKey);
+	return appId;
+}
+
+const std::string &AppKeys::getKey(int appId) const
+{
+	return keys[appId];
+}
+
+bool appKeyMatches(const std::string &pattern, const std::string &appKey)
+{
+	// Greedy matching, going back to the last '*' on a mismatch
+	size_t p = 0;
+	size_t k = 0;
+	size_t starP = std::string::npos;
+	size_t starK = 0;
+	while (k < appKey.size())
+	{
+		if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == appKey[k]))
+		{
+			p++;
+			k++;
+		}
+		else if (p < pattern.size() && pattern[p] == '*')
+		{
+			starP = p++;
+			starK = k;
+		}
+		else if (starP != std::string::npos)
+		{
+			// Let the last '*' match one more character
+			p = starP + 1;
+			k = ++starK;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	// Trailing '*'s match nothing
+	while (p < pattern.size() && pattern[p] == '*')
+		p++;
+	return p == pattern.size();
+}
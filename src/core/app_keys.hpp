@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ID of the empty application key (no application running)
+static constexpr const int noAppId = 0;
+
+/**
+ * Interns application keys to small integer IDs for the session,
+ * so what runs every tick compares applications without handling strings.
+ */
+class AppKeys
+{
+public:
+	AppKeys();
+
+	/// ID of appKey, a new one the first time it's seen
+	int intern(const std::string &appKey);
+
+	/// Key of an ID returned by intern
+	const std::string &getKey(int appId) const;
+
+private:
+	std::unordered_map<std::string, int> ids;
+	std::vector<std::string> keys;
+};
+
+/// Whether appKey matches pattern, where '*' matches any number of characters and '?' any single one
+bool appKeyMatches(const std::string &pattern, const std::string &appKey);
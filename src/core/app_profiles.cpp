@@ -0,0 +1,135 @@
+#include "app_profiles.hpp"
+
+#include <cstdint>
+#include <fstream>
+
+// File header ("OVRP" and format version)
+static constexpr const char profilesMagic[4] = {'O', 'V', 'R', 'P'};
+static constexpr const uint32_t profilesVersion = 1;
+
+// Weight of a new tick in the smoothed profile values
+static constexpr const float profileSmoothing = 0.2f;
+
+// Longest application key we'll read (OpenVR's k_unMaxApplicationKeyLength)
+static constexpr const uint32_t maxAppKeyLength = 128;
+
+template <typename T>
+static bool readValue(std::ifstream &file, T &value)
+{
+	return (bool)file.read(reinterpret_cast<char *>(&value), sizeof(value));
+}
+
+template <typename T>
+static void writeValue(std::ofstream &file, const T &value)
+{
+	file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+bool AppProfiles::load(const std::string &path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+
+	// Header
+	char magic[4];
+	uint32_t version;
+	uint32_t count;
+	if (!file.read(magic, sizeof(magic)) || std::char_traits<char>::compare(magic, profilesMagic, sizeof(magic)) != 0)
+		return false;
+	if (!readValue(file, version) || version != profilesVersion || !readValue(file, count))
+		return false;
+
+	// Profiles (key length, key, values)
+	std::map<std::string, AppProfile> loaded;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t keyLength;
+		if (!readValue(file, keyLength) || keyLength == 0 || keyLength > maxAppKeyLength)
+			return false;
+		std::string appKey(keyLength, '\0');
+		AppProfile profile;
+		if (!file.read(&appKey[0], keyLength) || !readValue(file, profile.res) || !readValue(file, profile.gpuTime) || !readValue(file, profile.vramUsed))
+			return false;
+		loaded[appKey] = profile;
+	}
+
+	profiles = std::move(loaded);
+	dirty = false;
+	return true;
+}
+
+bool AppProfiles::save(const std::string &path)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	file.write(profilesMagic, sizeof(profilesMagic));
+	writeValue(file, profilesVersion);
+	writeValue(file, (uint32_t)profiles.size());
+	for (const auto &[appKey, profile] : profiles)
+	{
+		writeValue(file, (uint32_t)appKey.size());
+		file.write(appKey.data(), appKey.size());
+		writeValue(file, profile.res);
+		writeValue(file, profile.gpuTime);
+		writeValue(file, profile.vramUsed);
+	}
+
+	if (!file)
+		return false;
+	dirty = false;
+	return true;
+}
+
+const AppProfile *AppProfiles::find(const std::string &appKey) const
+{
+	auto it = profiles.find(appKey);
+	if (it == profiles.end())
+		return nullptr;
+	return &it->second;
+}
+
+AppProfile *AppProfiles::find(const std::string &appKey)
+{
+	auto it = profiles.find(appKey);
+	if (it == profiles.end())
+		return nullptr;
+	return &it->second;
+}
+
+void AppProfiles::update(const std::string &appKey, float res, float gpuTime, float vramUsed)
+{
+	if (appKey == "" || appKey.size() > maxAppKeyLength)
+		return;
+
+	auto it = profiles.find(appKey);
+	if (it == profiles.end())
+	{
+		// First time
+		AppProfile profile;
+		profile.res = res;
+		profile.gpuTime = gpuTime;
+		profile.vramUsed = vramUsed;
+		profiles[appKey] = profile;
+	}
+	else
+	{
+		update(it->second, res, gpuTime, vramUsed);
+	}
+	dirty = true;
+}
+
+void AppProfiles::update(AppProfile &profile, float res, float gpuTime, float vramUsed)
+{
+	profile.res += (res - profile.res) * profileSmoothing;
+	profile.gpuTime += (gpuTime - profile.gpuTime) * profileSmoothing;
+	profile.vramUsed += (vramUsed - profile.vramUsed) * profileSmoothing;
+	dirty = true;
+}
+
+bool AppProfiles::isDirty() const
+{
+	return dirty;
+}
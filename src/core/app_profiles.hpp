@@ -0,0 +1,43 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+/// What was learned about an application during previous sessions
+struct AppProfile
+{
+	// Resolution dynamic resolution settled on (in percent)
+	float res = 0;
+	// Typical GPU frametime at that resolution
+	float gpuTime = 0;
+	// Typical VRAM usage (0-1), 0 if unknown
+	float vramUsed = 0;
+};
+
+/**
+ * Learned profiles by application key, persisted in a small binary file.
+ * Values are smoothed over the ticks where the resolution stayed the same, so a single odd scene doesn't overwrite them.
+ */
+class AppProfiles
+{
+public:
+	/// Returns false if the file doesn't exist or isn't a valid profiles file (the current profiles are kept)
+	bool load(const std::string &path);
+	bool save(const std::string &path);
+
+	/// nullptr if there's no profile for this application (stays valid until the profiles are loaded again)
+	const AppProfile *find(const std::string &appKey) const;
+	AppProfile *find(const std::string &appKey);
+
+	/// Records a tick where resolution settled at res
+	void update(const std::string &appKey, float res, float gpuTime, float vramUsed);
+	/// Same for a profile returned by find, without looking it up
+	void update(AppProfile &profile, float res, float gpuTime, float vramUsed);
+
+	/// Whether there are changes that weren't saved yet
+	bool isDirty() const;
+
+private:
+	std::map<std::string, AppProfile> profiles;
+	bool dirty = false;
+};
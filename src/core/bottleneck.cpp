@@ -0,0 +1,70 @@
+#include "bottleneck.hpp"
+
+bool canLowerResolutionHelp(Bottleneck bottleneck)
+{
+	// The compositor shares the GPU with the application
+	return bottleneck == Bottleneck_None || bottleneck == Bottleneck_Gpu || bottleneck == Bottleneck_Compositor;
+}
+
+bool canRaiseResolution(Bottleneck bottleneck)
+{
+	return bottleneck == Bottleneck_None || bottleneck == Bottleneck_AppCpu || bottleneck == Bottleneck_FrameCapped;
+}
+
+Bottleneck classifyBottleneck(const FrameHistory &frames, float frameBudget, float gpuTarget, bool intendedReprojection)
+{
+	int count = frames.size();
+	if (count == 0 || frameBudget <= 0)
+		return Bottleneck_None;
+
+	int dropped = 0;
+	int gpuReprojected = 0;
+	int cpuReprojected = 0;
+	int misPresented = 0;
+	int throttled = 0;
+	double gpuTime = 0;
+	double appCpuTime = 0;
+	double clientFrameInterval = 0;
+	for (int i = 0; i < count; i++)
+	{
+		const FrameSample &frame = frames.at(i);
+		dropped += frame.numDroppedFrames > 0;
+		misPresented += frame.numMisPresented > 0;
+		// Frames SteamVR held the application back for
+		throttled += (frame.reprojectionFlags & vr::VRCompositor_ThrottleMask) != 0;
+		// Reasons the previous frame got reused
+		gpuReprojected += (frame.reprojectionFlags & vr::VRCompositor_ReprojectionReason_Gpu) != 0;
+		cpuReprojected += (frame.reprojectionFlags & vr::VRCompositor_ReprojectionReason_Cpu) != 0;
+		gpuTime += frame.gpuTime;
+		appCpuTime += frame.appCpuTime + frame.submitTime;
+		clientFrameInterval += frame.clientFrameInterval;
+	}
+	gpuTime /= count;
+	appCpuTime /= count;
+	clientFrameInterval /= count;
+
+	// The compositor missing refreshes on its own
+	if (dropped > count * bottleneckDroppedFraction)
+		return gpuTime > gpuTarget ? Bottleneck_Gpu : Bottleneck_Compositor;
+
+	// Reprojection, by what made the application late
+	if (!intendedReprojection && (gpuReprojected > count * bottleneckReprojectedFraction || cpuReprojected > count * bottleneckReprojectedFraction))
+		return gpuReprojected >= cpuReprojected ? Bottleneck_Gpu : Bottleneck_AppCpu;
+
+	if (misPresented > count * bottleneckMisPresentedFraction)
+		return Bottleneck_MisPresented;
+
+	// Slower than the refresh rate while both the GPU and CPU have time to spare
+	// (SteamVR also throttles applications that can't keep up, which are then GPU or CPU bound)
+	bool hasTimeToSpare = gpuTime < gpuTarget && appCpuTime < frameBudget;
+	if (hasTimeToSpare && (throttled > count * bottleneckThrottledFraction || clientFrameInterval > frameBudget * bottleneckCappedInterval))
+		return Bottleneck_FrameCapped;
+
+	// About to miss refreshes
+	if (gpuTime > gpuTarget)
+		return Bottleneck_Gpu;
+	if (appCpuTime > frameBudget)
+		return Bottleneck_AppCpu;
+
+	return Bottleneck_None;
+}
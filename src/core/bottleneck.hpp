@@ -0,0 +1,43 @@
+#pragma once
+
+#include "frame_history.hpp"
+
+/// What limits the framerate, as told by the compositor's frame timings
+enum Bottleneck
+{
+	// Frames are within budget
+	Bottleneck_None = 0,
+	// The application's rendering takes too long on the GPU
+	Bottleneck_Gpu = 1,
+	// The application's CPU work makes it late
+	Bottleneck_AppCpu = 2,
+	// The compositor drops frames while the application is on time
+	Bottleneck_Compositor = 3,
+	// The application renders slower than it could (its own frame cap, or throttled by SteamVR)
+	Bottleneck_FrameCapped = 4,
+	// Frames are presented at the wrong time (timing or driver issue)
+	Bottleneck_MisPresented = 5,
+	Bottleneck_Count
+};
+
+static constexpr const char *bottleneckNames[Bottleneck_Count] = {"none", "GPU", "app CPU", "compositor", "frame capped", "mis-presented"};
+
+// Share of the frames showing a problem for it to be the bottleneck
+static constexpr const float bottleneckDroppedFraction = 0.02f;
+static constexpr const float bottleneckReprojectedFraction = 0.05f;
+static constexpr const float bottleneckMisPresentedFraction = 0.05f;
+static constexpr const float bottleneckThrottledFraction = 0.5f;
+// Frame interval (relative to the frame budget) past which an application with time to spare is frame capped
+static constexpr const float bottleneckCappedInterval = 1.5f;
+
+/// Whether lowering resolution can help with a bottleneck
+bool canLowerResolutionHelp(Bottleneck bottleneck);
+/// Whether raising resolution is safe with a bottleneck (the GPU has time to spare)
+bool canRaiseResolution(Bottleneck bottleneck);
+
+/**
+ * Labels what limits the framerate of the frames in the history.
+ * frameBudget is the time each frame has (longer when reprojecting on purpose, which then doesn't count as a problem),
+ * gpuTarget the GPU frametime past which frames are about to miss it.
+ */
+Bottleneck classifyBottleneck(const FrameHistory &frames, float frameBudget, float gpuTarget, bool intendedReprojection);
@@ -0,0 +1,421 @@
+#include "controller.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+bool isApplicationBlacklisted(const ControllerSettings &settings, const std::string &appKey)
+{
+	return appKey == "" || settings.blacklistAppsSet.find(appKey) != settings.blacklistAppsSet.end();
+}
+
+bool isApplicationWhitelisted(const ControllerSettings &settings, const std::string &appKey)
+{
+	return appKey != "" && settings.whitelistAppsSet.find(appKey) != settings.whitelistAppsSet.end();
+}
+
+bool isApplicationSupported(const ControllerSettings &settings, const std::string &appKey)
+{
+	return !isApplicationBlacklisted(settings, appKey) && (!settings.whitelistEnabled || isApplicationWhitelisted(settings, appKey));
+}
+
+// Keeps resolution from increasing past the VRAM target, and forces it to decrease past the VRAM limit
+static float limitForVram(float newRes, float lastRes, float vramUsed, const ControllerSettings &settings)
+{
+	if (vramUsed > settings.vramLimit / 100.0f)
+		return std::min(newRes, lastRes - settings.resDecreaseMin);
+	if (vramUsed >= settings.vramTarget / 100.0f)
+		return std::min(newRes, lastRes);
+	return newRes;
+}
+
+// Keeps resolution from moving in a direction that can't help with what limits the framerate
+static float limitForBottleneck(float newRes, float lastRes, bool canLower, bool canRaise)
+{
+	if ((newRes < lastRes && !canLower) || (newRes > lastRes && !canRaise))
+		return lastRes;
+	return newRes;
+}
+
+ResolutionController::ResolutionController(float initialRes) : newRes(initialRes)
+{
+}
+
+bool ResolutionController::shouldAdjustResolution(bool appSupported, bool inDashboard, float cpuTime, const ControllerSettings &settings) const
+{
+	// Only adjust resolution if not in dashboard, in a supported application. user didn't pause res and cpu time isn't below threshold
+	return !inDashboard && appSupported && !manualRes && !(settings.resetOnThreshold && cpuTime < settings.minCpuTimeThreshold);
+}
+
+void ResolutionController::setManualRes(bool manual)
+{
+	manualRes = manual;
+}
+
+bool ResolutionController::isManualRes() const
+{
+	return manualRes;
+}
+
+void ResolutionController::setResolution(float res)
+{
+	newRes = res;
+}
+
+float ResolutionController::getResolution() const
+{
+	return newRes;
+}
+
+int ResolutionController::getTickDelayMs(const FrameHistory &frames, const ControllerSettings &settings) const
+{
+	int maxDelay = std::max(settings.resChangeDelayMs, settings.resChangeDelayMinMs);
+	if (!settings.adaptiveResChangeDelay || settings.vramOnlyMode || settings.debugEnabled || targetFrametimeLow <= 0 || frames.size() < minFramesPerDecision)
+		return maxDelay;
+
+	// How far the frametime is outside of the targets
+	float gpuTime = frames.gpuTime(settings.frametimeEstimator);
+	float urgency = 0;
+	if (gpuTime > targetFrametimeLow)
+		urgency = (gpuTime - targetFrametimeLow) / targetFrametimeLow / maxDelayOverloadError;
+	else if (gpuTime < targetFrametimeHigh)
+		urgency = (targetFrametimeHigh - gpuTime) / targetFrametimeHigh / maxDelayHeadroomError;
+
+	// Trend (newest quarter of the frames against the oldest quarter), only when it's getting closer to overloading
+	int quarter = frames.size() / 4;
+	double oldest = 0;
+	double newest = 0;
+	for (int i = 0; i < quarter; i++)
+	{
+		oldest += frames.at(i).gpuTime;
+		newest += frames.at(frames.size() - 1 - i).gpuTime;
+	}
+	float trend = (newest - oldest) / quarter / targetFrametimeLow;
+	if (trend > 0 && gpuTime > (targetFrametimeHigh + targetFrametimeLow) / 2.0f)
+		urgency += trend / maxDelayOverloadError;
+
+	urgency = std::clamp(urgency, 0.0f, 1.0f);
+	return std::round(maxDelay - (maxDelay - settings.resChangeDelayMinMs) * urgency);
+}
+
+float ResolutionController::checkOverload(const FrameHistory &frames, int newFrames, const ControllerSettings &settings)
+{
+	if (!settings.emergencyDownscale || !adjusting || manualRes || hmdFrametime <= 0 || targetFrametimeLow <= 0)
+	{
+		resetOverload();
+		return 0;
+	}
+
+	// Frames over the refresh interval (or intervals, when reprojecting on purpose) miss it
+	float frameBudget = hmdFrametime * expectedFrameShown;
+	newFrames = std::min(newFrames, frames.size());
+	for (int i = frames.size() - newFrames; i < frames.size(); i++)
+	{
+		const FrameSample &frame = frames.at(i);
+		overloadWindowMs += frame.frameShown * hmdFrametime;
+		overloadWindowFrames++;
+		overloadWindowGpuTime += frame.gpuTime;
+		// Reprojected frames only count when the GPU is past the targets too (not when the CPU is late)
+		if (frame.gpuTime > frameBudget || (frame.frameShown > expectedFrameShown && frame.gpuTime > targetFrametimeLow))
+			overloadWindowOverBudget++;
+	}
+	if (overloadWindowMs < emergencyWindowMs)
+		return 0;
+
+	bool overloaded = overloadWindowOverBudget >= overloadWindowFrames * emergencyOverloadedFraction;
+	float gpuTime = overloadWindowGpuTime / overloadWindowFrames;
+	int persistence = overloaded ? overloadedWindows + 1 : 0;
+	resetOverload();
+	overloadedWindows = persistence;
+	if (overloadedWindows < emergencyPersistence)
+		return 0;
+	overloadedWindows = 0;
+
+	// Resolution expected to bring GPU frametime to the middle of the targets (resolution scales the pixel count linearly)
+	float targetFrametime = (targetFrametimeHigh + targetFrametimeLow) / 2.0f;
+	float cutRes = newRes * targetFrametime / gpuTime;
+	// Cuts at least as much as a regular decrease, even if the maximum is set lower
+	float maxCut = std::max<float>(settings.emergencyMaxCut, settings.resDecreaseMin);
+	cutRes = std::clamp(cutRes, newRes - maxCut, newRes - settings.resDecreaseMin);
+	cutRes = std::clamp((int)std::round(cutRes), settings.minRes, settings.maxRes);
+	if (cutRes >= newRes)
+		return 0;
+
+	newRes = cutRes;
+	pid.track(newRes, settings.minRes, settings.maxRes);
+	return newRes;
+}
+
+void ResolutionController::resetOverload()
+{
+	overloadWindowMs = 0;
+	overloadWindowFrames = 0;
+	overloadWindowOverBudget = 0;
+	overloadWindowGpuTime = 0;
+	overloadedWindows = 0;
+}
+
+ControllerDecision ResolutionController::update(const ControllerInput &input, const ControllerSettings &settings)
+{
+	ControllerDecision decision;
+
+#pragma region Getting data
+	// Check for external resolution change (if resolution got changed and it wasn't us)
+	if (settings.externalResChangeCompatibility && input.externalResChange && !manualRes)
+		manualRes = true;
+
+	// Check for end of external resolution change (if automatic resolution is enabled)
+	if (settings.externalResChangeCompatibility && !input.manualOverride)
+	{
+		decision.restoreManualOverride = true;
+		manualRes = false;
+	}
+
+	// Fetch resolution and target fps
+	newRes = input.currentRes;
+	float lastRes = newRes;
+	int displayFrequency = std::round(input.displayFrequency);
+	if (hmdHz != displayFrequency)
+	{
+		hmdHz = displayFrequency;
+		hmdFrametime = 1000.0f / displayFrequency;
+	}
+	if (hmdHz > 0)
+	{
+		decision.resIncreaseThresholdFps = std::round(1000.0f / ((settings.resIncreaseThreshold / 100.0f) * hmdFrametime));
+		decision.resDecreaseThresholdFps = std::round(1000.0f / ((settings.resDecreaseThreshold / 100.0f) * hmdFrametime));
+	}
+	decision.targetFpsHigh = decision.resIncreaseThresholdFps;
+	decision.targetFpsLow = decision.resDecreaseThresholdFps;
+	decision.targetFrametimeHigh = 1000.0f / decision.resIncreaseThresholdFps;
+	decision.targetFrametimeLow = 1000.0f / decision.resDecreaseThresholdFps;
+
+	// Only use frames rendered since the last resolution change
+	bool enoughFrames = input.frames && input.frames->size() >= minFramesPerDecision;
+	if (enoughFrames)
+	{
+		lastGpuTime = input.frames->gpuTime(settings.frametimeEstimator);
+		lastCpuTime = input.frames->cpuTime(settings.frametimeEstimator);
+		lastFrameShown = input.frames->averageFrameShown();
+	}
+	decision.waitingForFrames = !enoughFrames && !settings.debugEnabled;
+
+	float gpuTime = lastGpuTime;
+	float cpuTime = lastCpuTime;
+	float averageFrameShown = lastFrameShown;
+
+	// Debug override CPU and GPU
+	if (settings.debugEnabled)
+	{
+		gpuTime = settings.debugGpuFrametime;
+		cpuTime = settings.debugCpuFrametime;
+	}
+
+	// Reprojection logic
+	int reprojectionCount = 0;
+	if (!settings.ignoreCpuTime && hmdFrametime > 0)
+	{
+		reprojectionCount = cpuTime / hmdFrametime; // floored
+		if (!settings.preferReprojection)
+			reprojectionCount--;
+	}
+	// Scale with alwaysReproject and the const max
+	reprojectionCount = std::min(std::max(std::max(reprojectionCount, 0), settings.alwaysReproject), maxReprojectionCount);
+	if (reprojectionCount > 0)
+	{
+		decision.targetFpsHigh /= reprojectionCount + 1;
+		decision.targetFpsLow /= reprojectionCount + 1;
+		decision.targetFrametimeHigh *= reprojectionCount + 1;
+		decision.targetFrametimeLow *= reprojectionCount + 1;
+	}
+
+	// What limits the framerate (reprojecting on purpose isn't a problem)
+	if (enoughFrames && hmdFrametime > 0)
+		bottleneck = classifyBottleneck(*input.frames, hmdFrametime * (reprojectionCount + 1), decision.targetFrametimeLow, reprojectionCount > 0);
+	decision.bottleneck = bottleneck;
+	bool bottleneckAware = settings.bottleneckAware && !settings.debugEnabled;
+	bool canLower = !bottleneckAware || canLowerResolutionHelp(bottleneck);
+	bool canRaise = !bottleneckAware || canRaiseResolution(bottleneck);
+
+	// Keep the targets to schedule the next tick and check for overloads until then
+	if (hmdHz > 0)
+	{
+		targetFrametimeHigh = decision.targetFrametimeHigh;
+		targetFrametimeLow = decision.targetFrametimeLow;
+		expectedFrameShown = reprojectionCount + 1;
+	}
+
+	// VRAM usage
+	float vramUsed = input.vramUsed;
+	decision.vramUsedGB = input.vramUsedGB;
+	decision.vramAppUsedGB = input.vramAppUsedGB;
+
+	// Other applications' VRAM (browsers, overlays, etc.) doesn't count
+	if (settings.vramAppOnly && input.vramAppUsedGB > 0 && input.vramTotalGB > 0)
+		vramUsed = std::min((input.vramAppUsedGB + settings.vramHeadroomGB) / input.vramTotalGB, 1.0f);
+
+	// Debug override for VRAM
+	if (settings.debugEnabled)
+	{
+		decision.vramUsedGB = input.vramTotalGB * settings.debugVramUsage;
+		vramUsed = settings.debugVramUsage;
+	}
+
+	// GPU state (frametimes under the targets aren't headroom when the GPU is already at its limits)
+	decision.gpuUtilization = input.gpuUtilization;
+	decision.gpuThrottled = input.gpuThrottled;
+	bool gpuLimited = !settings.debugEnabled && ((settings.holdWhenThrottled && input.gpuThrottled) || (settings.gpuBusyLimit < 100 && input.gpuUtilization >= settings.gpuBusyLimit));
+
+	// Learn how GPU frametime scales with the pixels rendered (both eyes), separately for each application
+	float megapixels = 2.0f * input.renderWidth * input.renderHeight / 1000000.0f;
+	if (input.appId != modelAppId)
+	{
+		model.reset();
+		modelAppId = input.appId;
+	}
+	if (enoughFrames && !settings.debugEnabled)
+		model.add(megapixels, gpuTime, settings.modelForgetting);
+#pragma endregion
+
+#pragma region Resolution adjustment
+	decision.adjustResolution = shouldAdjustResolution(input.appSupported, input.inDashboard, cpuTime, settings);
+	bool usePid = settings.controllerMode == ControllerMode_Pid && !settings.vramOnlyMode;
+	// Falls back to stepping until the model is learned
+	bool useModel = settings.controllerMode == ControllerMode_Model && !settings.vramOnlyMode && megapixels > 0 && model.isReady();
+
+	// Start the PID controller over from the current resolution when it gets (re)enabled
+	if (!decision.adjustResolution || !usePid)
+	{
+		pid.reset();
+		pidElapsedMs = 0;
+	}
+	pidElapsedMs += input.elapsedMs > 0 ? input.elapsedMs : settings.resChangeDelayMs;
+
+	// Resolution to start from in the current application
+	// (a switch stays pending until resolution gets adjusted, e.g. once the dashboard is closed)
+	bool appChanged = input.appId != lastAppId;
+	if (decision.adjustResolution)
+		lastAppId = input.appId;
+	bool hasProfile = settings.appProfiles && input.appId != noAppId && input.profileRes > 0;
+	int startRes = hasProfile ? std::clamp((int)std::round(input.profileRes), settings.minRes, settings.maxRes) : settings.initialRes;
+
+	if (decision.adjustResolution && appChanged && hasProfile)
+	{
+		// Warm start from what was learned last time
+		newRes = startRes;
+		pid.reset();
+		pidElapsedMs = 0;
+	}
+	else if (decision.adjustResolution && !decision.waitingForFrames)
+	{
+		// Adjust resolution
+		if (usePid && cpuTime > settings.minCpuTimeThreshold)
+		{
+			PidGains gains;
+			gains.kp = settings.pidKp;
+			gains.ki = settings.pidKi;
+			gains.kd = settings.pidKd;
+			gains.derivativeFilter = settings.pidDerivativeFilter;
+
+			// Frametime
+			float targetFrametime = (decision.targetFrametimeHigh + decision.targetFrametimeLow) / 2.0f;
+			newRes = pid.update(targetFrametime, gpuTime, pidElapsedMs / 1000.0f, newRes, settings.minRes, settings.maxRes, gains);
+			pidElapsedMs = 0;
+			newRes = limitForBottleneck(newRes, lastRes, canLower, canRaise);
+
+			// VRAM and GPU state
+			newRes = limitForVram(newRes, lastRes, vramUsed, settings);
+			if (gpuLimited && newRes > lastRes)
+			{
+				newRes = lastRes;
+				decision.gpuLimited = true;
+			}
+
+			// Clamp the new resolution
+			newRes = std::clamp((int)std::round(newRes), settings.minRes, settings.maxRes);
+			pid.track(newRes, settings.minRes, settings.maxRes);
+		}
+		else if (useModel && cpuTime > settings.minCpuTimeThreshold)
+		{
+			// Frametime (resolution scales the pixel count linearly)
+			float targetFrametime = (decision.targetFrametimeHigh + decision.targetFrametimeLow) / 2.0f;
+			newRes = lastRes * model.megapixelsFor(targetFrametime) / megapixels;
+			newRes = limitForBottleneck(newRes, lastRes, canLower, canRaise);
+
+			// VRAM and GPU state
+			newRes = limitForVram(newRes, lastRes, vramUsed, settings);
+			if (gpuLimited && newRes > lastRes)
+			{
+				newRes = lastRes;
+				decision.gpuLimited = true;
+			}
+
+			// Clamp the new resolution
+			newRes = std::clamp((int)std::round(newRes), settings.minRes, settings.maxRes);
+		}
+		else if ((cpuTime > settings.minCpuTimeThreshold || settings.vramOnlyMode))
+		{
+			// Frametime
+			if (gpuTime < decision.targetFrametimeHigh && vramUsed < settings.vramTarget / 100.0f && !settings.vramOnlyMode)
+			{
+				// Increase resolution
+				if (!gpuLimited)
+					newRes += ((decision.targetFrametimeHigh - gpuTime) * (settings.resIncreaseScale / 100.0f)) + settings.resIncreaseMin;
+				decision.gpuLimited = gpuLimited;
+			}
+			else if (gpuTime > decision.targetFrametimeLow && !settings.vramOnlyMode)
+			{
+				// Decrease resolution
+				newRes -= ((gpuTime - decision.targetFrametimeLow) * (settings.resDecreaseScale / 100.0f)) + settings.resDecreaseMin;
+			}
+			newRes = limitForBottleneck(newRes, lastRes, canLower, canRaise);
+
+			// VRAM
+			if (vramUsed > settings.vramLimit / 100.0f)
+			{
+				// Force the resolution to decrease when the vram limit is reached
+				newRes -= settings.resDecreaseMin;
+			}
+			else if (settings.vramOnlyMode && newRes < settings.initialRes && vramUsed < settings.vramTarget / 100.0f)
+			{
+				// When in VRAM-only mode, make sure the res goes back up when possible.
+				newRes = std::min(settings.initialRes, (int)std::round(newRes) + settings.resIncreaseMin);
+			}
+
+			// Clamp the new resolution
+			newRes = std::clamp((int)std::round(newRes), settings.minRes, settings.maxRes);
+		}
+	}
+	else if (!decision.adjustResolution && (input.appId == noAppId || (settings.resetOnThreshold && cpuTime < settings.minCpuTimeThreshold)) && !manualRes)
+	{
+		// If (in SteamVR void or cpuTime below threshold) and user didn't pause res
+		// Reset to initialRes (or to the application's learned resolution)
+		newRes = startRes;
+	}
+#pragma endregion
+
+	decision.newRes = newRes;
+	decision.setResolution = newRes != lastRes;
+	adjusting = decision.adjustResolution && !settings.vramOnlyMode && !settings.debugEnabled;
+	if (decision.setResolution)
+		resetOverload();
+	decision.settled = decision.adjustResolution && !decision.waitingForFrames && !appChanged && !decision.setResolution && cpuTime > settings.minCpuTimeThreshold && !settings.debugEnabled;
+	decision.manualRes = manualRes;
+
+	decision.hmdHz = hmdHz;
+	decision.hmdFrametime = hmdFrametime;
+	decision.gpuTime = gpuTime;
+	decision.cpuTime = cpuTime;
+	decision.averageFrameShown = averageFrameShown;
+	decision.gpuFps = gpuTime > 0 ? std::round(1000.0f / gpuTime) : 0;
+	decision.cpuFps = cpuTime > 0 ? std::round(1000.0f / cpuTime) : 0;
+	// Estimated current FPS
+	decision.currentFps = hmdHz / averageFrameShown;
+	decision.vramUsed = vramUsed;
+	if (model.isReady())
+	{
+		decision.modelFixedTime = model.getFixedTime();
+		decision.modelMsPerMegapixel = model.getMsPerMegapixel();
+	}
+
+	return decision;
+}
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <set>
+#include <string>
+
+#include "app_keys.hpp"
+#include "bottleneck.hpp"
+#include "frame_history.hpp"
+#include "frametime_model.hpp"
+#include "pid_controller.hpp"
+
+static constexpr const int maxReprojectionCount = 3;
+
+// Frames rendered at the current resolution needed before it gets adjusted again
+static constexpr const int minFramesPerDecision = 16;
+
+// Frametime error (relative to the FPS targets) at which the adaptive delay reaches its minimum
+static constexpr const float maxDelayOverloadError = 0.25f;
+static constexpr const float maxDelayHeadroomError = 0.5f;
+
+// Emergency downscale: frames are checked in windows of about this long
+static constexpr const float emergencyWindowMs = 100.0f;
+// Share of the frames of a window over budget for it to be overloaded
+static constexpr const float emergencyOverloadedFraction = 0.5f;
+// Consecutive overloaded windows before cutting resolution (so single-frame hitches don't)
+static constexpr const int emergencyPersistence = 2;
+
+/// How the resolution is adjusted every tick
+enum ControllerMode
+{
+	// Proportional step plus a constant, with a dead zone between the FPS targets
+	ControllerMode_Step = 0,
+	// PID controller on the GPU frametime, targeting the middle of the FPS targets
+	ControllerMode_Pid = 1,
+	// Learns how GPU frametime scales with pixels and sets the resolution expected to hit the middle of the FPS targets
+	ControllerMode_Model = 2,
+	ControllerMode_Count
+};
+
+static constexpr const char *controllerModeNames[ControllerMode_Count] = {"Step", "PID", "Model"};
+
+/// Settings the resolution controller depends on, initialized to their defaults (also used by settings.ini)
+struct ControllerSettings
+{
+	// General
+	bool externalResChangeCompatibility = true;
+	std::set<std::string> blacklistAppsSet = {"steam.app.620980", "steam.app.658920", "steam.app.2177750", "steam.app.2177760"};
+	bool whitelistEnabled = false;
+	std::set<std::string> whitelistAppsSet = {};
+	// Resolution
+	// Delay between resolution changes (the longest delay when adaptive)
+	int resChangeDelayMs = 6000;
+	// Shorten the delay when frametimes are far from the targets or getting worse
+	bool adaptiveResChangeDelay = true;
+	int resChangeDelayMinMs = 250;
+	// Cut resolution right away (by up to emergencyMaxCut) when frames are over budget for a few hundred milliseconds
+	bool emergencyDownscale = true;
+	int emergencyMaxCut = 20;
+	int initialRes = 100;
+	int minRes = 70;
+	int maxRes = 190;
+	// Start applications at the resolution learned during previous sessions instead of initialRes
+	bool appProfiles = true;
+	float resIncreaseThreshold = 79;
+	float resDecreaseThreshold = 89;
+	int resIncreaseMin = 2;
+	int resDecreaseMin = 3;
+	int resIncreaseScale = 200;
+	int resDecreaseScale = 180;
+	float minCpuTimeThreshold = 0.6f;
+	bool resetOnThreshold = true;
+	int frametimeEstimator = FrametimeEstimator_Mean;
+	// Only lower resolution when it can help with what limits the framerate, and only raise it when the GPU has time to spare
+	bool bottleneckAware = true;
+	int controllerMode = ControllerMode_Step;
+	// PID gains (resolution percentages per ms of GPU frametime error)
+	float pidKp = 1.5f;
+	float pidKi = 0.25f;
+	float pidKd = 0.5f;
+	float pidDerivativeFilter = 3.0f;
+	// Weight kept by the previous samples of the frametime model every tick (0-1)
+	float modelForgetting = 0.8f;
+	// Reprojection
+	int alwaysReproject = 0;
+	bool preferReprojection = false;
+	bool ignoreCpuTime = false;
+	// VRAM
+	int vramTarget = 80;
+	int vramLimit = 90;
+	bool vramOnlyMode = false;
+	// Compare the VRAM used by the VR application (plus headroom for everything else) to the target and limit instead of the whole GPU's
+	bool vramAppOnly = true;
+	float vramHeadroomGB = 1.0f;
+	// GPU
+	// Don't increase resolution while the GPU is thermally or hardware throttled
+	bool holdWhenThrottled = true;
+	// Don't increase resolution while the GPU is busier than this percentage (100 = never)
+	int gpuBusyLimit = 98;
+	// Debug
+	bool debugEnabled = false;
+	float debugGpuFrametime = 10.0f;
+	float debugCpuFrametime = 10.0f;
+	float debugVramUsage = 0.5f;
+	// Frame trace recording (done by the caller, alongside the controller)
+	bool traceEnabled = false;
+	int traceMaxMB = 64;
+};
+
+/// Snapshot of the VR system state for a single controller tick
+struct ControllerInput
+{
+	// Resolution currently set in SteamVR (in percent)
+	float currentRes = 0;
+	// Whether SteamVR's resolution is set to custom instead of auto
+	bool manualOverride = true;
+	// Whether SteamVR's resolution was changed by someone else since the last tick
+	bool externalResChange = false;
+	// HMD display frequency in hz
+	float displayFrequency = 0;
+	// Time since the last tick, 0 if unknown (resChangeDelayMs is assumed)
+	long elapsedMs = 0;
+	// Resolution learned for the application during previous sessions, 0 if none
+	float profileRes = 0;
+	// Per-eye render target size at currentRes, 0 if unknown
+	uint32_t renderWidth = 0;
+	uint32_t renderHeight = 0;
+	// Frames rendered since the last resolution change
+	const FrameHistory *frames = nullptr;
+	// VRAM usage (0-1) and totals, 0 if unavailable
+	float vramUsed = 0;
+	float vramUsedGB = 0;
+	float vramTotalGB = 0;
+	// VRAM used by the VR application alone, 0 if unknown
+	float vramAppUsedGB = 0;
+	// GPU utilisation (0-100, -1 if unknown) and whether it's thermally or hardware throttled
+	int gpuUtilization = -1;
+	bool gpuThrottled = false;
+	// Current VR application, interned by AppKeys (noAppId if no app is running)
+	int appId = noAppId;
+	// Whether the current application's resolution may be adjusted (see isApplicationSupported)
+	bool appSupported = false;
+	// Whether the SteamVR dashboard is open
+	bool inDashboard = false;
+};
+
+/// What the controller decided during a tick, and the values it computed to get there
+struct ControllerDecision
+{
+	// Resolution to set in SteamVR
+	float newRes = 0;
+	// Whether newRes differs from the current SteamVR resolution
+	bool setResolution = false;
+	// Whether SteamVR's resolution should be switched back to custom
+	bool restoreManualOverride = false;
+	// Whether resolution is being adjusted dynamically
+	bool adjustResolution = true;
+	// Whether not enough frames were rendered since the last resolution change to adjust it
+	bool waitingForFrames = false;
+	// Whether resolution was adjusted and stayed the same (worth remembering for the application)
+	bool settled = false;
+	bool manualRes = false;
+
+	// Stats
+	int hmdHz = 0;
+	float hmdFrametime = 0;
+	// GPU and CPU frametimes according to the chosen estimator
+	float gpuTime = 0;
+	int gpuFps = 0;
+	float cpuTime = 0;
+	int cpuFps = 0;
+	float averageFrameShown = 0;
+	int currentFps = 0;
+	int targetFpsHigh = 0;
+	int targetFpsLow = 0;
+	float targetFrametimeHigh = 0;
+	float targetFrametimeLow = 0;
+	int resIncreaseThresholdFps = 0;
+	int resDecreaseThresholdFps = 0;
+	// VRAM usage compared to the target and limit (0-1)
+	float vramUsed = 0;
+	// Whole GPU and VR application VRAM usage (0 if unknown)
+	float vramUsedGB = 0;
+	float vramAppUsedGB = 0;
+	int gpuUtilization = -1;
+	bool gpuThrottled = false;
+	// Whether resolution was kept from increasing because the GPU is throttled or too busy
+	bool gpuLimited = false;
+	// What limits the framerate
+	Bottleneck bottleneck = Bottleneck_None;
+	// Frametime model (GPU ms = fixed + per megapixel * megapixels), 0 until it's learned
+	float modelFixedTime = 0;
+	float modelMsPerMegapixel = 0;
+};
+
+bool isApplicationBlacklisted(const ControllerSettings &settings, const std::string &appKey);
+
+bool isApplicationWhitelisted(const ControllerSettings &settings, const std::string &appKey);
+
+/// Whether an application isn't blacklisted (and is whitelisted when the whitelist is enabled)
+bool isApplicationSupported(const ControllerSettings &settings, const std::string &appKey);
+
+/**
+ * Decides the resolution to use from a snapshot of frame timings, VRAM and application state.
+ * Doesn't talk to OpenVR or the GPU itself so it can run anywhere.
+ */
+class ResolutionController
+{
+public:
+	explicit ResolutionController(float initialRes);
+
+	/// Runs a single controller tick
+	ControllerDecision update(const ControllerInput &input, const ControllerSettings &settings);
+
+	bool shouldAdjustResolution(bool appSupported, bool inDashboard, float cpuTime, const ControllerSettings &settings) const;
+
+	/// Delay before the next tick should run, according to how far the current frames are from the targets of the last tick
+	int getTickDelayMs(const FrameHistory &frames, const ControllerSettings &settings) const;
+
+	/**
+	 * Fast path run on every sample with the frames added since the previous one (the last newFrames of frames).
+	 * Returns the resolution to cut to right away when the frames have been over budget (missing refreshes)
+	 * for emergencyPersistence windows in a row, 0 otherwise. Increases are left to the ticks.
+	 */
+	float checkOverload(const FrameHistory &frames, int newFrames, const ControllerSettings &settings);
+
+	/// Pauses (or resumes) dynamic resolution
+	void setManualRes(bool manual);
+	bool isManualRes() const;
+
+	/// Notifies the controller of a resolution set by someone else (e.g. the manual resolution slider)
+	void setResolution(float res);
+	float getResolution() const;
+
+private:
+	float newRes;
+	bool manualRes = false;
+	int hmdHz = 0;
+	float hmdFrametime = 0;
+	// Averages from the last tick with enough frames
+	float lastGpuTime = 0;
+	float lastCpuTime = 0;
+	float lastFrameShown = 1;
+	// Targets of the last tick
+	float targetFrametimeHigh = 0;
+	float targetFrametimeLow = 0;
+	// Times frames are expected to be presented at the targets of the last tick
+	int expectedFrameShown = 1;
+	// Whether the last tick adjusted resolution dynamically
+	bool adjusting = false;
+	// Bottleneck of the last tick with enough frames
+	Bottleneck bottleneck = Bottleneck_None;
+
+	// Emergency downscale window
+	void resetOverload();
+	float overloadWindowMs = 0;
+	int overloadWindowFrames = 0;
+	int overloadWindowOverBudget = 0;
+	double overloadWindowGpuTime = 0;
+	int overloadedWindows = 0;
+
+	PidController pid;
+	// Time since the last PID update
+	long pidElapsedMs = 0;
+
+	FrametimeModel model;
+	// Application the frametime model was learned in
+	int modelAppId = noAppId;
+
+	// Application of the last tick
+	int lastAppId = noAppId;
+};
@@ -0,0 +1,152 @@
+#include "frame_history.hpp"
+
+#include <algorithm>
+
+static float estimate(const FrametimeHistogram &histogram, float mean, int estimator)
+{
+	switch (estimator)
+	{
+	case FrametimeEstimator_Median:
+		return histogram.quantile(0.5f);
+	case FrametimeEstimator_P90:
+		return histogram.quantile(0.9f);
+	case FrametimeEstimator_P95:
+		return histogram.quantile(0.95f);
+	case FrametimeEstimator_P99:
+		return histogram.quantile(0.99f);
+	case FrametimeEstimator_TrimmedMean:
+		return histogram.trimmedMean(trimmedMeanFraction);
+	default:
+		return mean;
+	}
+}
+
+int FrameHistory::ingest(const vr::Compositor_FrameTiming *frameTimings, int count)
+{
+	if (count <= 0)
+		return 0;
+
+	// Frame indices went backwards, the compositor got restarted
+	if (hasLastFrame && frameTimings[count - 1].m_nFrameIndex < lastFrameIndex)
+		hasLastFrame = false;
+
+	int added = 0;
+	for (int i = 0; i < count; i++)
+	{
+		const vr::Compositor_FrameTiming &frameTiming = frameTimings[i];
+
+		// Already counted
+		if (hasLastFrame && frameTiming.m_nFrameIndex <= lastFrameIndex)
+			continue;
+
+		FrameSample sample;
+		sample.frameIndex = frameTiming.m_nFrameIndex;
+
+		// Get GPU frametime
+		sample.gpuTime = frameTiming.m_flTotalRenderGpuMs;
+
+		// Calculate CPU frametime
+		// https://github.com/Louka3000/OpenVR-Dynamic-Resolution/issues/18#issuecomment-1833105172
+		float cpuTime = frameTiming.m_flCompositorRenderCpuMs								   // Compositor
+						+ (frameTiming.m_flNewFrameReadyMs - frameTiming.m_flNewPosesReadyMs); // Application & Late Start
+		sample.cpuTime = std::max(cpuTime, .0f);
+
+		// How many times the current frame repeated (>1 = reprojecting)
+		sample.frameShown = std::max((int)frameTiming.m_nNumFramePresents, 1);
+
+		sample.appCpuTime = std::max(frameTiming.m_flNewFrameReadyMs - frameTiming.m_flNewPosesReadyMs, .0f);
+		sample.submitTime = frameTiming.m_flSubmitFrameMs;
+		sample.compositorGpuTime = frameTiming.m_flCompositorRenderGpuMs;
+		sample.compositorCpuTime = frameTiming.m_flCompositorRenderCpuMs;
+		sample.clientFrameInterval = frameTiming.m_flClientFrameIntervalMs;
+		sample.reprojectionFlags = frameTiming.m_nReprojectionFlags;
+		sample.numMisPresented = (uint16_t)std::min(frameTiming.m_nNumMisPresented, 0xFFFFu);
+		sample.numDroppedFrames = (uint16_t)std::min(frameTiming.m_nNumDroppedFrames, 0xFFFFu);
+
+		add(sample);
+		added++;
+	}
+
+	return added;
+}
+
+void FrameHistory::add(const FrameSample &sample)
+{
+	// Evict the oldest frame when full
+	if (count == capacity)
+	{
+		const FrameSample &oldest = samples[head];
+		totalGpuTime -= oldest.gpuTime;
+		totalCpuTime -= oldest.cpuTime;
+		totalFrameShown -= oldest.frameShown;
+		gpuHistogram.remove(oldest.gpuTime);
+		cpuHistogram.remove(oldest.cpuTime);
+	}
+	else
+	{
+		count++;
+	}
+
+	samples[head] = sample;
+	head = (head + 1) % capacity;
+
+	totalGpuTime += sample.gpuTime;
+	totalCpuTime += sample.cpuTime;
+	totalFrameShown += sample.frameShown;
+	gpuHistogram.add(sample.gpuTime);
+	cpuHistogram.add(sample.cpuTime);
+
+	lastFrameIndex = sample.frameIndex;
+	hasLastFrame = true;
+}
+
+void FrameHistory::clear()
+{
+	head = 0;
+	count = 0;
+	totalGpuTime = 0;
+	totalCpuTime = 0;
+	totalFrameShown = 0;
+	gpuHistogram.clear();
+	cpuHistogram.clear();
+}
+
+int FrameHistory::size() const
+{
+	return count;
+}
+
+const FrameSample &FrameHistory::at(int i) const
+{
+	return samples[(head - count + i + capacity) % capacity];
+}
+
+uint32_t FrameHistory::getLastFrameIndex() const
+{
+	return lastFrameIndex;
+}
+
+float FrameHistory::averageGpuTime() const
+{
+	return count ? totalGpuTime / count : 0;
+}
+
+float FrameHistory::averageCpuTime() const
+{
+	return count ? totalCpuTime / count : 0;
+}
+
+float FrameHistory::averageFrameShown() const
+{
+	return count ? (float)totalFrameShown / (float)count : 1;
+}
+
+float FrameHistory::gpuTime(int estimator) const
+{
+	return estimate(gpuHistogram, averageGpuTime(), estimator);
+}
+
+float FrameHistory::cpuTime(int estimator) const
+{
+	return estimate(cpuHistogram, averageCpuTime(), estimator);
+}
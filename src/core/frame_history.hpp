@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+
+// OpenVR frame timing structures
+#include <openvr.h>
+
+#include "frametime_histogram.hpp"
+
+static constexpr const int openvrMaxFrames = 128;
+
+// Fraction of the fastest and slowest frames ignored by FrametimeEstimator_TrimmedMean
+static constexpr const float trimmedMeanFraction = 0.1f;
+
+/// The parts of a compositor frame timing the controller uses
+struct FrameSample
+{
+	uint32_t frameIndex = 0;
+	float gpuTime = 0;
+	float cpuTime = 0;
+	// How many times the frame was presented (>1 = reprojecting)
+	int frameShown = 1;
+
+	// Breakdown used to tell what limits the framerate (see classifyBottleneck)
+	// Application CPU time (new poses ready to new frame ready) and time spent submitting
+	float appCpuTime = 0;
+	float submitTime = 0;
+	// Compositor GPU and CPU time
+	float compositorGpuTime = 0;
+	float compositorCpuTime = 0;
+	// Time between the application's frames
+	float clientFrameInterval = 0;
+	// vr::VRCompositor_Reprojection* flags
+	uint32_t reprojectionFlags = 0;
+	// Times the frame was presented late, and frames the compositor dropped
+	uint16_t numMisPresented = 0;
+	uint16_t numDroppedFrames = 0;
+};
+
+/**
+ * Ring buffer of the last frames reported by the compositor.
+ * Frames are identified by their index so each one is only counted once,
+ * and the totals are kept up to date as frames get added and evicted.
+ */
+class FrameHistory
+{
+public:
+	static constexpr const int capacity = openvrMaxFrames;
+
+	/// Adds the frames that weren't seen yet (oldest first, as returned by GetFrameTimings), returns how many were added
+	int ingest(const vr::Compositor_FrameTiming *frameTimings, int count);
+
+	void add(const FrameSample &sample);
+
+	/// Forgets the current frames (e.g. after a resolution change), frames that were already seen stay ignored
+	void clear();
+
+	int size() const;
+	/// i = 0 is the oldest frame
+	const FrameSample &at(int i) const;
+	uint32_t getLastFrameIndex() const;
+
+	float averageGpuTime() const;
+	float averageCpuTime() const;
+	float averageFrameShown() const;
+
+	/// GPU and CPU frametimes according to an estimator (FrametimeEstimator)
+	float gpuTime(int estimator) const;
+	float cpuTime(int estimator) const;
+
+private:
+	FrameSample samples[capacity];
+	int head = 0;
+	int count = 0;
+
+	double totalGpuTime = 0;
+	double totalCpuTime = 0;
+	long totalFrameShown = 0;
+
+	FrametimeHistogram gpuHistogram;
+	FrametimeHistogram cpuHistogram;
+
+	uint32_t lastFrameIndex = 0;
+	bool hasLastFrame = false;
+};
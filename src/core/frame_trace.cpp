@@ -0,0 +1,148 @@
+#include "frame_trace.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+FrameTraceWriter::~FrameTraceWriter()
+{
+	close();
+}
+
+bool FrameTraceWriter::open(const std::string &path, size_t maxBytes)
+{
+	close();
+
+	size_t recordCapacity = (std::max(maxBytes, sizeof(FrameTraceHeader)) - sizeof(FrameTraceHeader)) / sizeof(FrameTraceRecord);
+	if (recordCapacity == 0)
+		return false;
+	size_t bytes = sizeof(FrameTraceHeader) + recordCapacity * sizeof(FrameTraceRecord);
+
+	// Create and map the file
+	void *memory = nullptr;
+#ifdef _WIN32
+	HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READWRITE, (DWORD)((uint64_t)bytes >> 32), (DWORD)(bytes & 0xFFFFFFFF), NULL);
+	if (mappingHandle != NULL)
+		memory = MapViewOfFile(mappingHandle, FILE_MAP_WRITE, 0, 0, bytes);
+	if (memory == nullptr)
+	{
+		if (mappingHandle != NULL)
+			CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		return false;
+	}
+	file = fileHandle;
+	mapping = mappingHandle;
+#else
+	int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return false;
+	if (ftruncate(fd, bytes) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+	memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (memory == MAP_FAILED)
+	{
+		::close(fd);
+		return false;
+	}
+	file = fd;
+#endif
+	mappedBytes = bytes;
+	capacity = (uint32_t)std::min<size_t>(recordCapacity, UINT32_MAX);
+
+	header = static_cast<FrameTraceHeader *>(memory);
+	records = reinterpret_cast<FrameTraceRecord *>(static_cast<char *>(memory) + sizeof(FrameTraceHeader));
+	std::memset(header, 0, sizeof(FrameTraceHeader));
+	std::memcpy(header->magic, frameTraceMagic, sizeof(frameTraceMagic));
+	header->version = frameTraceVersion;
+	header->recordSize = sizeof(FrameTraceRecord);
+
+	return true;
+}
+
+void FrameTraceWriter::close()
+{
+	if (!isOpen())
+		return;
+
+	// Only keep the records that were written
+	size_t usedBytes = sizeof(FrameTraceHeader) + (size_t)header->recordCount * sizeof(FrameTraceRecord);
+#ifdef _WIN32
+	UnmapViewOfFile(header);
+	CloseHandle(mapping);
+	LARGE_INTEGER size;
+	size.QuadPart = usedBytes;
+	if (SetFilePointerEx(file, size, NULL, FILE_BEGIN))
+		SetEndOfFile(file);
+	CloseHandle(file);
+	file = nullptr;
+	mapping = nullptr;
+#else
+	munmap(header, mappedBytes);
+	// Failing leaves the preallocated space, the header still tells how many records there are
+	[[maybe_unused]] int truncated = ftruncate(file, usedBytes);
+	::close(file);
+	file = -1;
+#endif
+
+	header = nullptr;
+	records = nullptr;
+	capacity = 0;
+	mappedBytes = 0;
+}
+
+bool FrameTraceWriter::isOpen() const
+{
+	return header != nullptr;
+}
+
+bool FrameTraceWriter::isFull() const
+{
+	return isOpen() && header->recordCount >= capacity;
+}
+
+void FrameTraceWriter::write(const vr::Compositor_FrameTiming &frameTiming, float res, float vramUsed, uint8_t flags)
+{
+	if (!isOpen() || isFull())
+		return;
+
+	if (header->recordCount == 0)
+		header->startTime = frameTiming.m_flSystemTimeInSeconds;
+
+	FrameTraceRecord &record = records[header->recordCount];
+	record.frameIndex = frameTiming.m_nFrameIndex;
+	record.time = (float)(frameTiming.m_flSystemTimeInSeconds - header->startTime);
+	record.totalRenderGpuMs = frameTiming.m_flTotalRenderGpuMs;
+	record.compositorRenderCpuMs = frameTiming.m_flCompositorRenderCpuMs;
+	record.newPosesReadyMs = frameTiming.m_flNewPosesReadyMs;
+	record.newFrameReadyMs = frameTiming.m_flNewFrameReadyMs;
+	record.clientFrameIntervalMs = frameTiming.m_flClientFrameIntervalMs;
+	record.res = res;
+	record.vramUsed = (uint16_t)std::clamp(vramUsed * 10000.0f, 0.0f, 10000.0f);
+	record.reprojectionFlags = (uint16_t)frameTiming.m_nReprojectionFlags;
+	record.numFramePresents = (uint8_t)std::min(frameTiming.m_nNumFramePresents, 255u);
+	record.numMisPresented = (uint8_t)std::min(frameTiming.m_nNumMisPresented, 255u);
+	record.numDroppedFrames = (uint8_t)std::min(frameTiming.m_nNumDroppedFrames, 255u);
+	record.flags = flags;
+
+	header->recordCount++;
+}
+
+uint32_t FrameTraceWriter::getRecordCount() const
+{
+	return isOpen() ? header->recordCount : 0;
+}
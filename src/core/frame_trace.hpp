@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// OpenVR frame timing structures
+#include <openvr.h>
+
+// Trace file header ("OVRT" and format version)
+static constexpr const char frameTraceMagic[4] = {'O', 'V', 'R', 'T'};
+static constexpr const uint32_t frameTraceVersion = 1;
+
+/// Start of a trace file, followed by recordCount FrameTraceRecords
+struct FrameTraceHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t recordSize;
+	// Records written so far (updated after every record, so a trace is readable even if OVRDR didn't exit cleanly)
+	uint32_t recordCount;
+	// Compositor system time of the first frame, in seconds
+	double startTime;
+	uint32_t reserved[2];
+};
+static_assert(sizeof(FrameTraceHeader) == 32, "trace header layout changed, bump frameTraceVersion");
+
+// FrameTraceRecord flags
+enum FrameTraceFlags
+{
+	FrameTraceFlag_AdjustResolution = 1 << 0,
+	FrameTraceFlag_ManualRes = 1 << 1,
+	FrameTraceFlag_WaitingForFrames = 1 << 2,
+	FrameTraceFlag_GpuThrottled = 1 << 3,
+};
+
+/// A compositor frame and what OVRDR was doing at the time (40 bytes, ~13 MB per hour at 90 hz)
+struct FrameTraceRecord
+{
+	uint32_t frameIndex;
+	// Seconds since FrameTraceHeader::startTime
+	float time;
+	float totalRenderGpuMs;
+	float compositorRenderCpuMs;
+	float newPosesReadyMs;
+	float newFrameReadyMs;
+	float clientFrameIntervalMs;
+	// Resolution set in SteamVR (in percent)
+	float res;
+	// VRAM usage in 1/10000, 0 if unknown
+	uint16_t vramUsed;
+	uint16_t reprojectionFlags;
+	uint8_t numFramePresents;
+	uint8_t numMisPresented;
+	uint8_t numDroppedFrames;
+	// FrameTraceFlags
+	uint8_t flags;
+};
+static_assert(sizeof(FrameTraceRecord) == 40, "trace record layout changed, bump frameTraceVersion");
+
+/**
+ * Appends frame records to a preallocated memory-mapped file, so recording is only a copy into memory.
+ * The file is truncated to the records actually written when closed. Recording stops once the file is full.
+ */
+class FrameTraceWriter
+{
+public:
+	FrameTraceWriter() = default;
+	FrameTraceWriter(const FrameTraceWriter &) = delete;
+	FrameTraceWriter &operator=(const FrameTraceWriter &) = delete;
+	~FrameTraceWriter();
+
+	/// Creates (or overwrites) the file at path, preallocated to maxBytes
+	bool open(const std::string &path, size_t maxBytes);
+	void close();
+	bool isOpen() const;
+	bool isFull() const;
+
+	/// Adds a frame, the OVRDR state (res, vramUsed, flags) has to be filled by the caller
+	void write(const vr::Compositor_FrameTiming &frameTiming, float res, float vramUsed, uint8_t flags);
+
+	uint32_t getRecordCount() const;
+
+private:
+	FrameTraceHeader *header = nullptr;
+	FrameTraceRecord *records = nullptr;
+	uint32_t capacity = 0;
+	size_t mappedBytes = 0;
+
+#ifdef _WIN32
+	void *file = nullptr;
+	void *mapping = nullptr;
+#else
+	int file = -1;
+#endif
+};
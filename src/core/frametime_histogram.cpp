@@ -0,0 +1,92 @@
+#include "frametime_histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Number of bins per unit of log(frametime)
+static const float binsPerLog = FrametimeHistogram::binCount / std::log(FrametimeHistogram::maxFrametime / FrametimeHistogram::minFrametime);
+
+int FrametimeHistogram::bin(float frametime)
+{
+	if (!(frametime > minFrametime))
+		return 0;
+	return std::min((int)(std::log(frametime / minFrametime) * binsPerLog), binCount - 1);
+}
+
+void FrametimeHistogram::add(float frametime)
+{
+	int i = bin(frametime);
+	counts[i]++;
+	sums[i] += frametime;
+	count++;
+}
+
+void FrametimeHistogram::remove(float frametime)
+{
+	int i = bin(frametime);
+	if (counts[i] == 0)
+		return;
+	counts[i]--;
+	sums[i] -= frametime;
+	// Don't let rounding errors accumulate in emptied bins
+	if (counts[i] == 0)
+		sums[i] = 0;
+	count--;
+}
+
+void FrametimeHistogram::clear()
+{
+	std::fill(counts, counts + binCount, 0);
+	std::fill(sums, sums + binCount, 0.0);
+	count = 0;
+}
+
+int FrametimeHistogram::size() const
+{
+	return count;
+}
+
+float FrametimeHistogram::quantile(float q) const
+{
+	if (count == 0)
+		return 0;
+
+	// Rank of the frame we're looking for
+	int rank = std::clamp((int)std::ceil(q * count), 1, count);
+	int seen = 0;
+	for (int i = 0; i < binCount; i++)
+	{
+		seen += counts[i];
+		if (seen >= rank)
+			return sums[i] / counts[i];
+	}
+	return 0;
+}
+
+float FrametimeHistogram::trimmedMean(float trim) const
+{
+	if (count == 0)
+		return 0;
+
+	// Frames to skip on each side
+	int skip = (int)(trim * count);
+	int keep = count - 2 * skip;
+	if (keep <= 0)
+		return quantile(0.5f);
+
+	double total = 0;
+	int seen = 0;
+	for (int i = 0; i < binCount && seen < skip + keep; i++)
+	{
+		if (counts[i] == 0)
+			continue;
+
+		// Part of this bin that's within the kept frames
+		int first = std::max(seen, skip);
+		int last = std::min(seen + counts[i], skip + keep);
+		if (last > first)
+			total += sums[i] / counts[i] * (last - first);
+		seen += counts[i];
+	}
+	return total / keep;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+/// Statistic used to summarize the frametimes of the frame history
+enum FrametimeEstimator
+{
+	FrametimeEstimator_Mean = 0,
+	FrametimeEstimator_Median = 1,
+	FrametimeEstimator_P90 = 2,
+	FrametimeEstimator_P95 = 3,
+	FrametimeEstimator_P99 = 4,
+	FrametimeEstimator_TrimmedMean = 5,
+	FrametimeEstimator_Count
+};
+
+static constexpr const char *frametimeEstimatorNames[FrametimeEstimator_Count] = {"mean", "median", "p90", "p95", "p99", "trimmed mean"};
+
+/**
+ * Fixed-size histogram of frametimes with logarithmic bins (~2.7% wide, 0.25 ms to 250 ms).
+ * Values can be removed as well as added so it can follow a sliding window of frames,
+ * and quantiles are accurate to a bin regardless of how many frames it holds.
+ */
+class FrametimeHistogram
+{
+public:
+	static constexpr const int binCount = 256;
+	static constexpr const float minFrametime = 0.25f;
+	static constexpr const float maxFrametime = 250.0f;
+
+	void add(float frametime);
+	void remove(float frametime);
+	void clear();
+
+	int size() const;
+
+	/// Frametime below which a fraction q (0-1) of the frames are
+	float quantile(float q) const;
+	/// Mean of the frames left after dropping a fraction of the fastest and slowest ones
+	float trimmedMean(float trim) const;
+
+private:
+	static int bin(float frametime);
+
+	int counts[binCount] = {};
+	// Sum of the frametimes in each bin, to give the mean of a bin instead of its bounds
+	double sums[binCount] = {};
+	int count = 0;
+};
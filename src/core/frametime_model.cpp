@@ -0,0 +1,98 @@
+#include "frametime_model.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Initial covariance of the fixed time (small, so it stays near 0 until there's data to tell it apart) and of the ms per megapixel
+static constexpr const double initialFixedTimeVariance = 1.0;
+static constexpr const double initialMsPerMegapixelVariance = 1000.0;
+
+// Relative prediction error above which the model is considered outdated
+static constexpr const double sceneChangeError = 0.15;
+
+
+FrametimeModel::FrametimeModel()
+{
+	reset();
+}
+
+void FrametimeModel::reset()
+{
+	theta[0] = 0;
+	theta[1] = 0;
+	p[0][0] = initialFixedTimeVariance;
+	p[0][1] = 0;
+	p[1][0] = 0;
+	p[1][1] = initialMsPerMegapixelVariance;
+	samples = 0;
+}
+
+void FrametimeModel::add(float megapixels, float gpuTime, float forgetting)
+{
+	if (megapixels <= 0 || gpuTime <= 0)
+		return;
+
+	double lambda = std::clamp((double)forgetting, 0.5, 1.0);
+	double x[2] = {1.0, megapixels};
+
+	// The scene changed too much for what was learned to still hold, start learning again from the current estimate
+	double prediction = theta[0] * x[0] + theta[1] * x[1];
+	if (samples > 0 && std::fabs(gpuTime - prediction) > sceneChangeError * prediction)
+	{
+		p[0][0] = initialFixedTimeVariance;
+		p[0][1] = 0;
+		p[1][0] = 0;
+		p[1][1] = initialMsPerMegapixelVariance;
+	}
+
+	// Gain
+	double px[2] = {p[0][0] * x[0] + p[0][1] * x[1], p[1][0] * x[0] + p[1][1] * x[1]};
+	double denominator = lambda + x[0] * px[0] + x[1] * px[1];
+	double k[2] = {px[0] / denominator, px[1] / denominator};
+
+	// Parameters
+	double error = gpuTime - prediction;
+	theta[0] += k[0] * error;
+	theta[1] += k[1] * error;
+
+	// Covariance
+	double newP[2][2];
+	for (int i = 0; i < 2; i++)
+		for (int j = 0; j < 2; j++)
+			newP[i][j] = (p[i][j] - k[i] * px[j]) / lambda;
+	// Keep it from blowing up when the resolution stays the same for a long time (nothing new is learned but everything is forgotten)
+	p[0][0] = std::min(newP[0][0], initialFixedTimeVariance);
+	p[1][1] = std::min(newP[1][1], initialMsPerMegapixelVariance);
+	// Keep it symmetric and positive definite
+	double maxCovariance = std::sqrt(p[0][0] * p[1][1]) * 0.99;
+	p[0][1] = p[1][0] = std::clamp((newP[0][1] + newP[1][0]) / 2, -maxCovariance, maxCovariance);
+
+	samples++;
+}
+
+bool FrametimeModel::isReady() const
+{
+	return samples > 0 && theta[1] > 0;
+}
+
+float FrametimeModel::predict(float megapixels) const
+{
+	return theta[0] + theta[1] * megapixels;
+}
+
+float FrametimeModel::megapixelsFor(float gpuTime) const
+{
+	if (theta[1] <= 0)
+		return 0;
+	return std::max((gpuTime - theta[0]) / theta[1], 0.0);
+}
+
+float FrametimeModel::getFixedTime() const
+{
+	return theta[0];
+}
+
+float FrametimeModel::getMsPerMegapixel() const
+{
+	return theta[1];
+}
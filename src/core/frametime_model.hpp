@@ -0,0 +1,35 @@
+#pragma once
+
+/**
+ * Online linear model of the GPU frametime against the number of pixels rendered (gpuTime = fixedTime + msPerMegapixel * megapixels),
+ * fitted with recursive least squares so older samples are gradually forgotten as the scene changes.
+ * The fixed cost starts at 0 and is only learned once samples at different resolutions come in.
+ * A prediction far off from the measured frametime (scene change) makes it relearn quickly from its current estimate.
+ */
+class FrametimeModel
+{
+public:
+	FrametimeModel();
+
+	void reset();
+
+	/// forgetting (0-1) is the weight kept by the previous samples, lower forgets faster
+	void add(float megapixels, float gpuTime, float forgetting);
+
+	/// Whether the model can be used to predict frametimes
+	bool isReady() const;
+
+	float predict(float megapixels) const;
+	/// Megapixels expected to render in gpuTime
+	float megapixelsFor(float gpuTime) const;
+
+	float getFixedTime() const;
+	float getMsPerMegapixel() const;
+
+private:
+	// Parameters (fixed time, ms per megapixel)
+	double theta[2];
+	// Covariance of the parameters
+	double p[2][2];
+	int samples = 0;
+};
@@ -0,0 +1,101 @@
+#include "metric_history.hpp"
+
+#include <algorithm>
+#include <limits>
+
+static constexpr const float emptyMin = std::numeric_limits<float>::infinity();
+static constexpr const float emptyMax = -std::numeric_limits<float>::infinity();
+
+MetricPoint::MetricPoint()
+{
+	clear();
+}
+
+void MetricPoint::clear()
+{
+	std::fill(min, min + MetricSeries_Count, emptyMin);
+	std::fill(max, max + MetricSeries_Count, emptyMax);
+}
+
+void MetricPoint::add(MetricSeries series, float value)
+{
+	min[series] = std::min(min[series], value);
+	max[series] = std::max(max[series], value);
+}
+
+void MetricHistory::add(const MetricPoint &point)
+{
+	for (int level = 0; level < metricHistoryLevelCount; level++)
+	{
+		int shift = metricHistoryLevelShift * level;
+		int slot = metricHistoryLevelOffset(level) + (int)((total >> shift) % metricHistoryLevelCapacity(level));
+		// First point of a value at this level
+		bool first = (total & ((1u << shift) - 1)) == 0;
+		for (int series = 0; series < MetricSeries_Count; series++)
+		{
+			if (first)
+			{
+				minValues[series][slot] = point.min[series];
+				maxValues[series][slot] = point.max[series];
+			}
+			else
+			{
+				minValues[series][slot] = std::min(minValues[series][slot], point.min[series]);
+				maxValues[series][slot] = std::max(maxValues[series][slot], point.max[series]);
+			}
+		}
+	}
+	total++;
+}
+
+void MetricHistory::clear()
+{
+	total = 0;
+}
+
+int MetricHistory::size() const
+{
+	return (int)std::min(total, (uint32_t)metricHistoryCapacity);
+}
+
+void MetricHistory::decimate(MetricSeries series, int windowPoints, int columns, float *minOut, float *maxOut) const
+{
+	if (columns <= 0)
+		return;
+	windowPoints = std::max(windowPoints, 1);
+
+	// Coarsest level whose values still fit in a column
+	int level = 0;
+	while (level + 1 < metricHistoryLevelCount && (windowPoints >> (metricHistoryLevelShift * (level + 1))) >= columns)
+		level++;
+	int shift = metricHistoryLevelShift * level;
+	int offset = metricHistoryLevelOffset(level);
+	int capacityAtLevel = metricHistoryLevelCapacity(level);
+
+	const float *minValues = this->minValues[series];
+	const float *maxValues = this->maxValues[series];
+	int64_t start = (int64_t)total - windowPoints;
+	int64_t oldest = (int64_t)total - size();
+	for (int column = 0; column < columns; column++)
+	{
+		// Points in this column (at least one, repeated when there are more columns than points)
+		int64_t from = start + (int64_t)column * windowPoints / columns;
+		int64_t to = std::max(start + (int64_t)(column + 1) * windowPoints / columns, from + 1);
+		from = std::max(from, oldest);
+
+		float low = emptyMin;
+		float high = emptyMax;
+		if (from < to)
+		{
+			// Values partially in the column are counted whole (they're never wider than a column)
+			for (int64_t value = from >> shift; value <= (to - 1) >> shift; value++)
+			{
+				int slot = offset + (int)(value % capacityAtLevel);
+				low = std::min(low, minValues[slot]);
+				high = std::max(high, maxValues[slot]);
+			}
+		}
+		minOut[column] = low;
+		maxOut[column] = high;
+	}
+}
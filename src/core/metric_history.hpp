@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+
+/// Values recorded in the metric history
+enum MetricSeries
+{
+	MetricSeries_GpuTime = 0,
+	MetricSeries_CpuTime = 1,
+	// Frametime targets (ms)
+	MetricSeries_TargetLow = 2,
+	MetricSeries_TargetHigh = 3,
+	MetricSeries_Resolution = 4,
+	MetricSeries_VramUsedGB = 5,
+	MetricSeries_Count
+};
+
+/// Lowest and highest value of each series over a metric history interval, empty series have min > max
+struct MetricPoint
+{
+	float min[MetricSeries_Count];
+	float max[MetricSeries_Count];
+
+	MetricPoint();
+
+	void clear();
+	void add(MetricSeries series, float value);
+};
+
+static constexpr const int metricHistoryIntervalMs = 100;
+// 30 minutes
+static constexpr const int metricHistoryCapacity = 30 * 60 * 1000 / metricHistoryIntervalMs;
+// Levels of detail, each level's values cover 2^metricHistoryLevelShift times more points than the previous one
+static constexpr const int metricHistoryLevelCount = 5;
+static constexpr const int metricHistoryLevelShift = 2;
+
+/// Values kept at a level of detail (one spare for the partially filled values at both ends)
+static constexpr int metricHistoryLevelCapacity(int level)
+{
+	return (metricHistoryCapacity >> (metricHistoryLevelShift * level)) + 2;
+}
+
+/// Where a level of detail starts in the storage of a series
+static constexpr int metricHistoryLevelOffset(int level)
+{
+	return level == 0 ? 0 : metricHistoryLevelOffset(level - 1) + metricHistoryLevelCapacity(level - 1);
+}
+
+/**
+ * Fixed-size history of the last 30 minutes of metric points, one every metricHistoryIntervalMs.
+ * Each series is stored as its own arrays (structure of arrays), along with coarser copies
+ * where each value covers 4, 16, 64 and 256 points, so decimating any window length
+ * to a number of columns only reads a few values per column.
+ */
+class MetricHistory
+{
+public:
+	void add(const MetricPoint &point);
+	void clear();
+
+	/// Points currently held (up to metricHistoryCapacity)
+	int size() const;
+
+	/**
+	 * Lowest and highest value of a series over equal slices of the last windowPoints points, the newest in the last column.
+	 * Columns without any point (older than the history) get min > max.
+	 */
+	void decimate(MetricSeries series, int windowPoints, int columns, float *minOut, float *maxOut) const;
+
+private:
+	static constexpr const int storageSize = metricHistoryLevelOffset(metricHistoryLevelCount);
+
+	float minValues[MetricSeries_Count][storageSize];
+	float maxValues[MetricSeries_Count][storageSize];
+	// Points added since the last clear
+	uint32_t total = 0;
+};
@@ -0,0 +1,65 @@
+#include "pid_controller.hpp"
+
+#include <algorithm>
+
+void PidController::reset()
+{
+	active = false;
+	integral = 0;
+	lastMeasurement = 0;
+	derivative = 0;
+	lastProportional = 0;
+	lastDerivative = 0;
+}
+
+float PidController::update(float setpoint, float measurement, float dt, float currentOutput, float minOutput, float maxOutput, const PidGains &gains)
+{
+	float error = setpoint - measurement;
+	float proportional = gains.kp * error;
+
+	// Start from the current output (bumpless transfer)
+	if (!active)
+	{
+		active = true;
+		integral = std::clamp(currentOutput - proportional, minOutput, maxOutput);
+		lastMeasurement = measurement;
+		derivative = 0;
+	}
+
+	// Derivative on measurement, low-pass filtered
+	if (dt > 0)
+	{
+		float rawDerivative = -(measurement - lastMeasurement) / dt;
+		float alpha = gains.derivativeFilter / (gains.derivativeFilter + dt);
+		derivative = alpha * derivative + (1 - alpha) * rawDerivative;
+	}
+	lastMeasurement = measurement;
+	float derivativeTerm = gains.kd * derivative;
+
+	// Only integrate if it doesn't push an already saturated output further
+	float newIntegral = integral + gains.ki * error * dt;
+	float output = proportional + newIntegral + derivativeTerm;
+	bool saturatedHigh = output > maxOutput && error > 0;
+	bool saturatedLow = output < minOutput && error < 0;
+	if (!saturatedHigh && !saturatedLow)
+		integral = std::clamp(newIntegral, minOutput, maxOutput);
+
+	lastProportional = proportional;
+	lastDerivative = derivativeTerm;
+
+	return std::clamp(proportional + integral + derivativeTerm, minOutput, maxOutput);
+}
+
+void PidController::track(float appliedOutput, float minOutput, float maxOutput)
+{
+	if (!active)
+		return;
+	// Back-calculate the integral that would have given the applied output
+	float trackedIntegral = appliedOutput - lastProportional - lastDerivative;
+	integral = std::clamp(std::min(integral, trackedIntegral), minOutput, maxOutput);
+}
+
+bool PidController::isActive() const
+{
+	return active;
+}
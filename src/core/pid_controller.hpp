@@ -0,0 +1,46 @@
+#pragma once
+
+/// Gains of a PidController
+struct PidGains
+{
+	// Output per unit of error
+	float kp = 0;
+	// Output per unit of error per second
+	float ki = 0;
+	// Output per unit of error change per second
+	float kd = 0;
+	// Time constant in seconds of the low-pass filter on the derivative (0 = unfiltered)
+	float derivativeFilter = 0;
+};
+
+/**
+ * Positional PID controller.
+ * The derivative is taken on the measurement (so setpoint changes don't kick the output) and low-pass filtered,
+ * and the integral stops winding up while the output is saturated.
+ */
+class PidController
+{
+public:
+	/// Forgets the integral and derivative, the next update starts from the current output again
+	void reset();
+
+	/**
+	 * Returns the new output, limited to [minOutput, maxOutput].
+	 * currentOutput is only used on the first update after a reset, to start without a jump.
+	 */
+	float update(float setpoint, float measurement, float dt, float currentOutput, float minOutput, float maxOutput, const PidGains &gains);
+
+	/// Tells the controller that the output got limited further by something else, so the integral doesn't wind up
+	void track(float appliedOutput, float minOutput, float maxOutput);
+
+	bool isActive() const;
+
+private:
+	bool active = false;
+	float integral = 0;
+	float lastMeasurement = 0;
+	float derivative = 0;
+	// Proportional and derivative terms of the last update
+	float lastProportional = 0;
+	float lastDerivative = 0;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+
+/**
+ * Lock-free fixed-size single-producer single-consumer queue.
+ * Holds up to Size - 1 items, push() fails instead of waiting when it's full.
+ */
+template <typename T, int Size>
+class SpscQueue
+{
+public:
+	/// Producer side
+	bool push(const T &item)
+	{
+		int tail = this->tail.load(std::memory_order_relaxed);
+		int next = (tail + 1) % Size;
+		// Full
+		if (next == head.load(std::memory_order_acquire))
+			return false;
+
+		items[tail] = item;
+		this->tail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	/// Consumer side
+	bool pop(T &item)
+	{
+		int head = this->head.load(std::memory_order_relaxed);
+		// Empty
+		if (head == tail.load(std::memory_order_acquire))
+			return false;
+
+		item = items[head];
+		this->head.store((head + 1) % Size, std::memory_order_release);
+		return true;
+	}
+
+private:
+	T items[Size];
+	alignas(64) std::atomic<int> head{0};
+	alignas(64) std::atomic<int> tail{0};
+};
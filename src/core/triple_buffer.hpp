@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+
+/**
+ * Lock-free single-writer single-reader triple buffer.
+ * The writer always has a buffer to write to and the reader always gets the latest complete value,
+ * neither of them ever waits for the other.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+	/// Writer side: publishes a new value
+	void write(const T &value)
+	{
+		buffers[back] = value;
+		// Swap our buffer with the middle one, flagged as new
+		back = middle.exchange(back | newFlag, std::memory_order_acq_rel) & indexMask;
+	}
+
+	/// Reader side: copies the latest value if a new one was written since the last read
+	bool read(T &value)
+	{
+		if (!(middle.load(std::memory_order_relaxed) & newFlag))
+			return false;
+
+		// Swap our buffer with the middle one, which is the latest written
+		front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+		value = buffers[front];
+		return true;
+	}
+
+private:
+	static constexpr const int indexMask = 3;
+	static constexpr const int newFlag = 4;
+
+	T buffers[3];
+	// Only used by the writer
+	int back = 0;
+	// Index of the middle buffer, plus newFlag if it wasn't read yet
+	alignas(64) std::atomic<int> middle{1};
+	// Only used by the reader
+	alignas(64) int front = 2;
+};
@@ -0,0 +1,163 @@
+#include "workload.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "frame_trace.hpp"
+
+// Recorded frames are averaged over this many seconds to make keyframes
+static constexpr const double traceKeyframeInterval = 0.1;
+
+double Workload::duration() const
+{
+	return keyframes.empty() ? 0 : keyframes.back().time;
+}
+
+WorkloadState Workload::at(double time) const
+{
+	if (keyframes.empty())
+		return WorkloadState();
+	if (time <= keyframes.front().time)
+		return keyframes.front().state;
+	if (time >= keyframes.back().time)
+		return keyframes.back().state;
+
+	// First keyframe after time
+	auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time, [](double t, const WorkloadKeyframe &keyframe)
+								 { return t < keyframe.time; });
+	const WorkloadKeyframe &a = *(next - 1);
+	const WorkloadKeyframe &b = *next;
+	float f = (float)((time - a.time) / (b.time - a.time));
+
+	WorkloadState state;
+	state.gpuFixedMs = a.state.gpuFixedMs + (b.state.gpuFixedMs - a.state.gpuFixedMs) * f;
+	state.gpuMsPerMegapixel = a.state.gpuMsPerMegapixel + (b.state.gpuMsPerMegapixel - a.state.gpuMsPerMegapixel) * f;
+	state.cpuMs = a.state.cpuMs + (b.state.cpuMs - a.state.cpuMs) * f;
+	state.vramFixedGB = a.state.vramFixedGB + (b.state.vramFixedGB - a.state.vramFixedGB) * f;
+	state.vramGBPerMegapixel = a.state.vramGBPerMegapixel + (b.state.vramGBPerMegapixel - a.state.vramGBPerMegapixel) * f;
+	state.noise = a.state.noise + (b.state.noise - a.state.noise) * f;
+	state.steamVrThrottling = a.state.steamVrThrottling;
+	return state;
+}
+
+const std::vector<std::string> &Workload::syntheticNames()
+{
+	static const std::vector<std::string> names = {"steady", "ramp", "square", "noisy", "vram", "throttled"};
+	return names;
+}
+
+bool Workload::synthetic(const std::string &name, Workload &workload)
+{
+	workload = Workload();
+	workload.name = name;
+
+	WorkloadState light;
+	WorkloadState heavy = light;
+	heavy.gpuMsPerMegapixel = 1.3f;
+
+	if (name == "steady")
+	{
+		// Settling from the initial resolution
+		workload.keyframes = {{0, light}, {120, light}};
+		workload.disturbances = {0};
+	}
+	else if (name == "ramp")
+	{
+		// Scene getting heavier then lighter over a minute each
+		workload.keyframes = {{0, light}, {30, light}, {90, heavy}, {150, light}, {180, light}};
+		workload.disturbances = {0, 30, 90, 150};
+	}
+	else if (name == "square")
+	{
+		// Alternating between a light and a heavy scene
+		for (int i = 0; i < 6; i++)
+		{
+			const WorkloadState &state = i % 2 ? heavy : light;
+			workload.keyframes.push_back({i * 30.0, state});
+			workload.keyframes.push_back({i * 30.0 + 30, state});
+			workload.disturbances.push_back(i * 30.0);
+		}
+	}
+	else if (name == "noisy")
+	{
+		// Spiky frametimes (e.g. shader compilation, streaming)
+		WorkloadState noisy = light;
+		noisy.noise = 0.25f;
+		workload.keyframes = {{0, noisy}, {120, noisy}};
+		workload.disturbances = {0};
+	}
+	else if (name == "vram")
+	{
+		// Textures streaming in until VRAM runs out, then getting freed
+		WorkloadState full = light;
+		full.vramFixedGB = 9.0f;
+		workload.keyframes = {{0, light}, {30, light}, {60, full}, {120, full}, {121, light}, {150, light}};
+		workload.disturbances = {0, 30, 120};
+	}
+	else if (name == "throttled")
+	{
+		// GPU-bound scene SteamVR throttles to half rate, which resolution has to get out of
+		WorkloadState throttled = heavy;
+		throttled.steamVrThrottling = true;
+		workload.keyframes = {{0, light}, {30, light}, {30, throttled}, {90, throttled}, {90, light}, {120, light}};
+		workload.disturbances = {0, 30, 90};
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+bool Workload::fromTrace(const std::string &path, float megapixelsAt100, Workload &workload)
+{
+	std::ifstream trace(path, std::ios::binary);
+	if (!trace)
+		return false;
+
+	FrameTraceHeader header;
+	if (!trace.read(reinterpret_cast<char *>(&header), sizeof(header)) || std::memcmp(header.magic, frameTraceMagic, sizeof(frameTraceMagic)) != 0)
+		return false;
+	if (header.version != frameTraceVersion || header.recordSize != sizeof(FrameTraceRecord))
+		return false;
+
+	workload = Workload();
+	workload.name = "trace";
+	workload.disturbances = {0};
+
+	// Average the frames of each interval into a keyframe
+	FrameTraceRecord record;
+	double intervalStart = 0;
+	double gpuMsPerMegapixel = 0;
+	double cpuMs = 0;
+	int frames = 0;
+	for (uint32_t i = 0; i < header.recordCount && trace.read(reinterpret_cast<char *>(&record), sizeof(record)); i++)
+	{
+		if (frames > 0 && record.time - intervalStart >= traceKeyframeInterval)
+		{
+			WorkloadKeyframe keyframe;
+			keyframe.time = intervalStart;
+			keyframe.state.gpuFixedMs = 0;
+			keyframe.state.gpuMsPerMegapixel = gpuMsPerMegapixel / frames;
+			keyframe.state.cpuMs = cpuMs / frames;
+			// Recorded frametimes already have their own noise
+			keyframe.state.noise = 0;
+			workload.keyframes.push_back(keyframe);
+
+			intervalStart = record.time;
+			gpuMsPerMegapixel = 0;
+			cpuMs = 0;
+			frames = 0;
+		}
+
+		if (record.res <= 0)
+			continue;
+
+		gpuMsPerMegapixel += record.totalRenderGpuMs / (megapixelsAt100 * record.res / 100.0f);
+		cpuMs += std::max(record.compositorRenderCpuMs + (record.newFrameReadyMs - record.newPosesReadyMs), 0.0f);
+		frames++;
+	}
+
+	return workload.keyframes.size() >= 2;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/// How heavy an application is at a point in time, independently of resolution
+struct WorkloadState
+{
+	// GPU frametime = gpuFixedMs + gpuMsPerMegapixel * megapixels rendered (both eyes)
+	float gpuFixedMs = 0.5f;
+	float gpuMsPerMegapixel = 0.8f;
+	float cpuMs = 5.0f;
+	// VRAM used = vramFixedGB + vramGBPerMegapixel * megapixels rendered
+	float vramFixedGB = 4.0f;
+	float vramGBPerMegapixel = 0.2f;
+	// Relative standard deviation of the GPU frametime from frame to frame
+	float noise = 0.02f;
+	// Whether SteamVR throttles the application while it misses refreshes (instead of flagging them as late)
+	bool steamVrThrottling = false;
+};
+
+/// WorkloadState at a given time, linearly interpolated between keyframes (two keyframes at the same time make a step)
+struct WorkloadKeyframe
+{
+	double time = 0;
+	WorkloadState state;
+};
+
+/**
+ * Synthetic or recorded application workload over time, to run the resolution controller without a headset.
+ * The GPU frametime reacts to the resolution through the pixel count like a real application's would.
+ */
+class Workload
+{
+public:
+	std::string name;
+	std::vector<WorkloadKeyframe> keyframes;
+	// Times at which the workload changes suddenly (the controller should settle after each of them)
+	std::vector<double> disturbances;
+
+	double duration() const;
+	WorkloadState at(double time) const;
+
+	/// Names of the built-in workloads
+	static const std::vector<std::string> &syntheticNames();
+	/// Built-in workload (steady, ramp, square, noisy, vram, throttled), returns false for an unknown name
+	static bool synthetic(const std::string &name, Workload &workload);
+	/**
+	 * Workload recorded in a frame trace (see FrameTraceWriter), the GPU cost per megapixel is derived from the resolution at the time.
+	 * megapixelsAt100 is the pixel count (both eyes) at 100% resolution of the headset the trace was recorded with.
+	 */
+	static bool fromTrace(const std::string &path, float megapixelsAt100, Workload &workload);
+};
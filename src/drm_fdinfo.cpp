@@ -0,0 +1,193 @@
+#include "drm_fdinfo.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// DRM clients of a process counted once (more are still counted, maybe twice)
+static constexpr const int maxDrmClients = 32;
+
+// fdinfo of a DRM client is usually well under 2 KB
+static constexpr const int fdinfoBufferSize = 4096;
+
+/// Directory entry returned by getdents64 (not declared by older glibc versions)
+struct LinuxDirent64
+{
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[1];
+};
+
+/// If [line, lineEnd) starts with key, points value past it and returns true
+static bool matchKey(const char *line, const char *lineEnd, const char *key, const char *&value)
+{
+	size_t keyLength = std::strlen(key);
+	if ((size_t)(lineEnd - line) < keyLength || std::memcmp(line, key, keyLength) != 0)
+		return false;
+	value = line + keyLength;
+	return true;
+}
+
+static const char *skipSpaces(const char *text, const char *end)
+{
+	while (text < end && (*text == ' ' || *text == '\t'))
+		text++;
+	return text;
+}
+
+/// Parses "<number> [KiB|MiB|GiB]" into bytes
+static uint64_t parseSize(const char *text, const char *end)
+{
+	text = skipSpaces(text, end);
+	uint64_t value = 0;
+	while (text < end && *text >= '0' && *text <= '9')
+		value = value * 10 + (*text++ - '0');
+
+	text = skipSpaces(text, end);
+	if (end - text >= 3 && std::memcmp(text + 1, "iB", 2) == 0)
+	{
+		if (*text == 'K')
+			value <<= 10;
+		else if (*text == 'M')
+			value <<= 20;
+		else if (*text == 'G')
+			value <<= 30;
+	}
+	return value;
+}
+
+/// If the memory region name at text (up to ':') is device-local memory, points value past the ':' and returns true
+static bool matchVramRegion(const char *text, const char *lineEnd, const char *&value)
+{
+	const char *colon = (const char *)std::memchr(text, ':', lineEnd - text);
+	if (!colon)
+		return false;
+	// amdgpu: vram, xe: vram0, i915: local0
+	size_t nameLength = colon - text;
+	bool isVram = (nameLength >= 4 && std::memcmp(text, "vram", 4) == 0) || (nameLength >= 5 && std::memcmp(text, "local", 5) == 0);
+	value = colon + 1;
+	return isVram;
+}
+
+bool parseDrmFdinfo(const char *text, size_t length, DrmFdinfo &info)
+{
+	info = DrmFdinfo();
+	// Newer kernels print both, drm-memory-* being the legacy name of drm-resident-*
+	uint64_t residentBytes = 0;
+	uint64_t memoryBytes = 0;
+	bool hasResident = false;
+
+	const char *end = text + length;
+	for (const char *line = text; line < end;)
+	{
+		const char *lineEnd = (const char *)std::memchr(line, '\n', end - line);
+		if (!lineEnd)
+			lineEnd = end;
+
+		const char *value;
+		if (matchKey(line, lineEnd, "drm-driver:", value))
+		{
+			info.isDrm = true;
+		}
+		else if (matchKey(line, lineEnd, "drm-client-id:", value))
+		{
+			info.clientId = parseSize(value, lineEnd);
+		}
+		else if (matchKey(line, lineEnd, "drm-pdev:", value))
+		{
+			value = skipSpaces(value, lineEnd);
+			size_t pdevLength = std::min((size_t)(lineEnd - value), sizeof(info.pdev) - 1);
+			std::memcpy(info.pdev, value, pdevLength);
+			info.pdev[pdevLength] = '\0';
+		}
+		else if (matchKey(line, lineEnd, "drm-resident-", value) && matchVramRegion(value, lineEnd, value))
+		{
+			residentBytes += parseSize(value, lineEnd);
+			hasResident = true;
+		}
+		else if (matchKey(line, lineEnd, "drm-memory-", value) && matchVramRegion(value, lineEnd, value))
+		{
+			memoryBytes += parseSize(value, lineEnd);
+		}
+
+		line = lineEnd + 1;
+	}
+
+	info.vramBytes = hasResident ? residentBytes : memoryBytes;
+	return info.isDrm;
+}
+
+bool readProcessDrmVram(uint32_t processId, const char *pdev, uint64_t &vramBytes)
+{
+	vramBytes = 0;
+
+	// The links in fd tell which file descriptors are DRM devices without generating every fdinfo
+	char path[32];
+	std::snprintf(path, sizeof(path), "/proc/%u/fd", processId);
+	int fdDir = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fdDir < 0)
+		return false;
+	std::snprintf(path, sizeof(path), "/proc/%u/fdinfo", processId);
+	int fdinfoDir = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fdinfoDir < 0)
+	{
+		close(fdDir);
+		return false;
+	}
+
+	uint64_t clientIds[maxDrmClients];
+	int clientCount = 0;
+	bool found = false;
+
+	alignas(LinuxDirent64) char entries[4096];
+	long entriesSize;
+	while ((entriesSize = syscall(SYS_getdents64, fdDir, entries, sizeof(entries))) > 0)
+	{
+		for (long offset = 0; offset < entriesSize;)
+		{
+			const LinuxDirent64 *entry = (const LinuxDirent64 *)(entries + offset);
+			offset += entry->d_reclen;
+			if (entry->d_name[0] == '.')
+				continue;
+
+			// /dev/dri/card0, /dev/dri/renderD128
+			char target[16];
+			ssize_t targetLength = readlinkat(fdDir, entry->d_name, target, sizeof(target));
+			if (targetLength < 9 || std::memcmp(target, "/dev/dri/", 9) != 0)
+				continue;
+
+			// Might have been closed since
+			int fd = openat(fdinfoDir, entry->d_name, O_RDONLY | O_CLOEXEC);
+			if (fd < 0)
+				continue;
+			char text[fdinfoBufferSize];
+			ssize_t length = read(fd, text, sizeof(text));
+			close(fd);
+
+			DrmFdinfo info;
+			if (length <= 0 || !parseDrmFdinfo(text, length, info))
+				continue;
+			// Clients that don't say which GPU they're on are counted
+			if (pdev && pdev[0] && info.pdev[0] && std::strcmp(info.pdev, pdev) != 0)
+				continue;
+
+			if (std::find(clientIds, clientIds + clientCount, info.clientId) != clientIds + clientCount)
+				continue;
+			if (clientCount < maxDrmClients)
+				clientIds[clientCount++] = info.clientId;
+
+			vramBytes += info.vramBytes;
+			found = true;
+		}
+	}
+
+	close(fdinfoDir);
+	close(fdDir);
+	return found;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// The parts of a DRM file descriptor's fdinfo used to attribute VRAM to a process (Linux)
+struct DrmFdinfo
+{
+	// Whether the file descriptor is a DRM client at all
+	bool isDrm = false;
+	// Identifies the client, file descriptors sharing it (dup, fork) share its memory too
+	uint64_t clientId = 0;
+	// PCI address of the GPU (0000:03:00.0)
+	char pdev[16] = {};
+	// Device-local memory resident for the client, in bytes
+	uint64_t vramBytes = 0;
+};
+
+/**
+ * Parses the text of /proc/<pid>/fdinfo/<fd> (see the kernel's drm-usage-stats documentation).
+ * Handles the drm-resident-<region> keys and the older drm-memory-<region> ones, for vram and local regions.
+ * Doesn't allocate, returns whether the file descriptor is a DRM client.
+ */
+bool parseDrmFdinfo(const char *text, size_t length, DrmFdinfo &info);
+
+/**
+ * VRAM used by a process on the GPU at PCI address pdev, summed over its DRM clients.
+ * Doesn't allocate, returns false if the process has no DRM client on that GPU or can't be read.
+ */
+bool readProcessDrmVram(uint32_t processId, const char *pdev, uint64_t &vramBytes);
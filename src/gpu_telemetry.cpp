@@ -0,0 +1,405 @@
+#include "gpu_telemetry.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+// To load the NVML library at runtime
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "drm_fdinfo.hpp"
+#endif
+
+#pragma region Dynamic libraries
+#ifdef _WIN32
+typedef HMODULE LibraryHandle;
+
+static LibraryHandle loadLibrary(const char *name)
+{
+	return LoadLibraryA(name);
+}
+
+static void *loadSymbol(LibraryHandle library, const char *name)
+{
+	return (void *)GetProcAddress(library, name);
+}
+
+static void unloadLibrary(LibraryHandle library)
+{
+	FreeLibrary(library);
+}
+#else
+typedef void *LibraryHandle;
+
+static LibraryHandle loadLibrary(const char *name)
+{
+	return dlopen(name, RTLD_LAZY | RTLD_LOCAL);
+}
+
+static void *loadSymbol(LibraryHandle library, const char *name)
+{
+	return dlsym(library, name);
+}
+
+static void unloadLibrary(LibraryHandle library)
+{
+	dlclose(library);
+}
+#endif
+#pragma endregion
+
+#pragma region NVML
+typedef enum nvmlReturn_enum
+{
+	NVML_SUCCESS = 0,					// The operation was successful.
+	NVML_ERROR_UNINITIALIZED = 1,		// NVML was not first initialized with nvmlInit.
+	NVML_ERROR_INVALID_ARGUMENT = 2,	// A supplied argument is invalid.
+	NVML_ERROR_NOT_SUPPORTED = 3,		// The requested operation is not available on target device.
+	NVML_ERROR_NO_PERMISSION = 4,		// The currrent user does not have permission for operation.
+	NVML_ERROR_ALREADY_INITIALIZED = 5, // NVML has already been initialized.
+	NVML_ERROR_NOT_FOUND = 6,			// A query to find an object was unccessful.
+	NVML_ERROR_UNKNOWN = 7,				// An internal driver error occurred.
+} nvmlReturn_t;
+typedef struct
+{
+	unsigned long long total;
+	unsigned long long free;
+	unsigned long long used;
+} nvmlMemory_t;
+typedef struct
+{
+	unsigned int gpu;
+	unsigned int memory;
+} nvmlUtilization_t;
+typedef enum nvmlClockType_enum
+{
+	NVML_CLOCK_GRAPHICS = 0,
+} nvmlClockType_t;
+typedef struct nvmlDevice_st *nvmlDevice_t;
+typedef nvmlReturn_t (*nvmlInit_t)();
+typedef nvmlReturn_t (*nvmlShutdown_t)();
+typedef nvmlReturn_t (*nvmlDeviceGetCount_t)(unsigned int *);
+typedef nvmlReturn_t (*nvmlDeviceGetHandleByIndex_t)(unsigned int, nvmlDevice_t *);
+typedef nvmlReturn_t (*nvmlDeviceGetMemoryInfo_t)(nvmlDevice_t, nvmlMemory_t *);
+typedef nvmlReturn_t (*nvmlDeviceGetUtilizationRates_t)(nvmlDevice_t, nvmlUtilization_t *);
+typedef nvmlReturn_t (*nvmlDeviceGetClockInfo_t)(nvmlDevice_t, nvmlClockType_t, unsigned int *);
+typedef nvmlReturn_t (*nvmlDeviceGetCurrentClocksThrottleReasons_t)(nvmlDevice_t, unsigned long long *);
+
+// Throttle reasons meaning the GPU is slowed down: HW slowdown, SW/HW thermal slowdown and HW power brake
+// (not the SW power cap, which boost clocks hit under any full load, nor idling, application clocks, sync boost or display clocks)
+static constexpr const unsigned long long nvmlLimitingThrottleReasons = 0x8 | 0x20 | 0x40 | 0x80;
+
+#ifdef _WIN32
+static constexpr const char *nvmlLibraryNames[] = {"nvml.dll"};
+#else
+// The unversioned name only exists when the development package is installed
+static constexpr const char *nvmlLibraryNames[] = {"libnvidia-ml.so.1", "libnvidia-ml.so"};
+#endif
+
+/// GPU telemetry of an NVIDIA GPU, with every NVML function resolved once when created
+class NvmlTelemetry : public GpuTelemetry
+{
+public:
+	/// NVML telemetry of the NVIDIA GPU at gpuIndex, nullptr if there's none (deviceCount = NVIDIA GPUs found)
+	static std::unique_ptr<NvmlTelemetry> create(int gpuIndex, int &deviceCount)
+	{
+		deviceCount = 0;
+		std::unique_ptr<NvmlTelemetry> telemetry(new NvmlTelemetry());
+		if (!telemetry->load())
+			return nullptr;
+
+		unsigned int count = 0;
+		if (telemetry->deviceGetCount(&count) != NVML_SUCCESS)
+			return nullptr;
+		deviceCount = (int)count;
+
+		if (gpuIndex < 0 || gpuIndex >= deviceCount || telemetry->deviceGetHandleByIndex(gpuIndex, &telemetry->device) != NVML_SUCCESS)
+			return nullptr;
+		telemetry->gpuIndex = gpuIndex;
+
+		unsigned int maxClock;
+		if (telemetry->deviceGetMaxClockInfo && telemetry->deviceGetMaxClockInfo(telemetry->device, NVML_CLOCK_GRAPHICS, &maxClock) == NVML_SUCCESS)
+			telemetry->maxClockMHz = (int)maxClock;
+		return telemetry;
+	}
+
+	~NvmlTelemetry() override
+	{
+		if (initialized)
+			nvmlShutdown();
+		if (library)
+			unloadLibrary(library);
+	}
+
+	std::string getName() override
+	{
+		return "NVML, GPU " + std::to_string(gpuIndex);
+	}
+
+	bool read(GpuTelemetrySample &sample) override
+	{
+		nvmlMemory_t memory;
+		if (deviceGetMemoryInfo(device, &memory) != NVML_SUCCESS || memory.total == 0)
+			return false;
+		sample.vramUsedBytes = memory.used;
+		sample.vramTotalBytes = memory.total;
+
+		// Not supported by every GPU and driver
+		nvmlUtilization_t utilization;
+		if (deviceGetUtilizationRates && deviceGetUtilizationRates(device, &utilization) == NVML_SUCCESS)
+			sample.utilization = (int)utilization.gpu;
+		unsigned int clock;
+		if (deviceGetClockInfo && deviceGetClockInfo(device, NVML_CLOCK_GRAPHICS, &clock) == NVML_SUCCESS)
+			sample.clockMHz = (int)clock;
+		sample.maxClockMHz = maxClockMHz;
+		unsigned long long throttleReasons;
+		if (deviceGetCurrentClocksThrottleReasons && deviceGetCurrentClocksThrottleReasons(device, &throttleReasons) == NVML_SUCCESS)
+			sample.throttled = (throttleReasons & nvmlLimitingThrottleReasons) != 0;
+		return true;
+	}
+
+private:
+	NvmlTelemetry() = default;
+
+	/// Loads NVML and resolves the functions used, returns false if any is missing
+	bool load()
+	{
+		for (const char *name : nvmlLibraryNames)
+		{
+			library = loadLibrary(name);
+			if (library)
+				break;
+		}
+		if (!library)
+			return false;
+
+		// Prefer the current versions of the functions that have one
+		nvmlInit_t nvmlInit = (nvmlInit_t)resolve("nvmlInit_v2", "nvmlInit");
+		nvmlShutdown = (nvmlShutdown_t)resolve("nvmlShutdown");
+		deviceGetCount = (nvmlDeviceGetCount_t)resolve("nvmlDeviceGetCount_v2", "nvmlDeviceGetCount");
+		deviceGetHandleByIndex = (nvmlDeviceGetHandleByIndex_t)resolve("nvmlDeviceGetHandleByIndex_v2", "nvmlDeviceGetHandleByIndex");
+		deviceGetMemoryInfo = (nvmlDeviceGetMemoryInfo_t)resolve("nvmlDeviceGetMemoryInfo");
+		if (!nvmlInit || !nvmlShutdown || !deviceGetCount || !deviceGetHandleByIndex || !deviceGetMemoryInfo)
+			return false;
+
+		// Optional
+		deviceGetUtilizationRates = (nvmlDeviceGetUtilizationRates_t)resolve("nvmlDeviceGetUtilizationRates");
+		deviceGetClockInfo = (nvmlDeviceGetClockInfo_t)resolve("nvmlDeviceGetClockInfo");
+		deviceGetMaxClockInfo = (nvmlDeviceGetClockInfo_t)resolve("nvmlDeviceGetMaxClockInfo");
+		// Renamed in recent drivers
+		deviceGetCurrentClocksThrottleReasons = (nvmlDeviceGetCurrentClocksThrottleReasons_t)resolve("nvmlDeviceGetCurrentClocksEventReasons", "nvmlDeviceGetCurrentClocksThrottleReasons");
+
+		initialized = nvmlInit() == NVML_SUCCESS;
+		return initialized;
+	}
+
+	void *resolve(const char *name, const char *fallbackName = nullptr)
+	{
+		void *symbol = loadSymbol(library, name);
+		if (!symbol && fallbackName)
+			symbol = loadSymbol(library, fallbackName);
+		return symbol;
+	}
+
+	LibraryHandle library = nullptr;
+	bool initialized = false;
+	int gpuIndex = 0;
+	nvmlDevice_t device = nullptr;
+	int maxClockMHz = 0;
+
+	nvmlShutdown_t nvmlShutdown = nullptr;
+	nvmlDeviceGetCount_t deviceGetCount = nullptr;
+	nvmlDeviceGetHandleByIndex_t deviceGetHandleByIndex = nullptr;
+	nvmlDeviceGetMemoryInfo_t deviceGetMemoryInfo = nullptr;
+	nvmlDeviceGetUtilizationRates_t deviceGetUtilizationRates = nullptr;
+	nvmlDeviceGetClockInfo_t deviceGetClockInfo = nullptr;
+	nvmlDeviceGetClockInfo_t deviceGetMaxClockInfo = nullptr;
+	nvmlDeviceGetCurrentClocksThrottleReasons_t deviceGetCurrentClocksThrottleReasons = nullptr;
+};
+#pragma endregion
+
+#pragma region amdgpu
+#ifndef _WIN32
+static constexpr const char *drmPath = "/sys/class/drm";
+
+// amdgpu doesn't report throttle reasons, the GPU is considered throttled this close to its critical temperature
+// (not at its power cap, which it reaches under any full load)
+static constexpr const uint64_t amdgpuCriticalTempMargin = 5000; // millidegrees
+
+/// Reads an integer from a sysfs file kept open, returns false if it can't be read
+static bool readSysfsNumber(int fd, uint64_t &value)
+{
+	// sysfs files are regenerated when read from the start
+	char buffer[32];
+	ssize_t length = pread(fd, buffer, sizeof(buffer) - 1, 0);
+	if (length <= 0)
+		return false;
+	buffer[length] = '\0';
+
+	char *end;
+	value = std::strtoull(buffer, &end, 10);
+	return end != buffer;
+}
+
+/// Opens a sysfs file to read it repeatedly, -1 if it doesn't exist
+static int openSysfs(const std::string &path)
+{
+	return open(path.c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+static void closeSysfs(int &fd)
+{
+	if (fd >= 0)
+		close(fd);
+	fd = -1;
+}
+
+/// GPU telemetry of an AMD GPU from the amdgpu driver's sysfs files
+class AmdgpuTelemetry : public GpuTelemetry
+{
+public:
+	/// amdgpu telemetry of the AMD GPU at gpuIndex (ordered by DRM card number), nullptr if there's none
+	static std::unique_ptr<AmdgpuTelemetry> create(int gpuIndex)
+	{
+		// Cards (card0, card1, ...) but not their connectors (card0-DP-1, ...)
+		std::vector<int> cards;
+		std::error_code error;
+		for (const auto &entry : std::filesystem::directory_iterator(drmPath, error))
+		{
+			std::string name = entry.path().filename().string();
+			if (name.size() <= 4 || name.compare(0, 4, "card") != 0 || name.find_first_not_of("0123456789", 4) != std::string::npos)
+				continue;
+			// Only amdgpu has these
+			if (std::filesystem::exists(entry.path() / "device" / "mem_info_vram_total", error))
+				cards.push_back(std::stoi(name.substr(4)));
+		}
+		std::sort(cards.begin(), cards.end());
+		if (gpuIndex < 0 || gpuIndex >= (int)cards.size())
+			return nullptr;
+
+		std::unique_ptr<AmdgpuTelemetry> telemetry(new AmdgpuTelemetry());
+		telemetry->card = cards[gpuIndex];
+		std::string devicePath = std::string(drmPath) + "/card" + std::to_string(telemetry->card) + "/device/";
+		telemetry->vramUsedFd = openSysfs(devicePath + "mem_info_vram_used");
+		telemetry->vramTotalFd = openSysfs(devicePath + "mem_info_vram_total");
+		if (telemetry->vramUsedFd < 0 || telemetry->vramTotalFd < 0)
+			return nullptr;
+		telemetry->busyFd = openSysfs(devicePath + "gpu_busy_percent");
+		telemetry->maxClockMHz = readMaxClockMHz(devicePath + "pp_dpm_sclk");
+
+		// Sensors (hwmon/hwmon<n>)
+		for (const auto &entry : std::filesystem::directory_iterator(devicePath + "hwmon", error))
+		{
+			std::string hwmonPath = entry.path().string() + "/";
+			// Shader clock in hz
+			telemetry->clockFd = openSysfs(hwmonPath + "freq1_input");
+			// Junction temperature (hottest spot) when there is one, in millidegrees
+			telemetry->tempFd = openSysfs(hwmonPath + "temp2_input");
+			telemetry->tempCriticalFd = openSysfs(hwmonPath + "temp2_crit");
+			if (telemetry->tempFd < 0 || telemetry->tempCriticalFd < 0)
+			{
+				closeSysfs(telemetry->tempFd);
+				closeSysfs(telemetry->tempCriticalFd);
+				telemetry->tempFd = openSysfs(hwmonPath + "temp1_input");
+				telemetry->tempCriticalFd = openSysfs(hwmonPath + "temp1_crit");
+			}
+			break;
+		}
+
+		// PCI address, to tell the processes' DRM clients on this GPU from those on others
+		std::string pciAddress = std::filesystem::canonical(devicePath, error).filename().string();
+		std::snprintf(telemetry->pdev, sizeof(telemetry->pdev), "%s", pciAddress.c_str());
+		return telemetry;
+	}
+
+	~AmdgpuTelemetry() override
+	{
+		for (int *fd : {&vramUsedFd, &vramTotalFd, &busyFd, &clockFd, &tempFd, &tempCriticalFd})
+			closeSysfs(*fd);
+	}
+
+	std::string getName() override
+	{
+		return "amdgpu, card" + std::to_string(card);
+	}
+
+	bool read(GpuTelemetrySample &sample) override
+	{
+		uint64_t used, total;
+		if (!readSysfsNumber(vramUsedFd, used) || !readSysfsNumber(vramTotalFd, total) || total == 0)
+			return false;
+		sample.vramUsedBytes = used;
+		sample.vramTotalBytes = total;
+
+		uint64_t value;
+		if (busyFd >= 0 && readSysfsNumber(busyFd, value))
+			sample.utilization = (int)std::min<uint64_t>(value, 100);
+		if (clockFd >= 0 && readSysfsNumber(clockFd, value))
+			sample.clockMHz = (int)(value / 1000000);
+		sample.maxClockMHz = maxClockMHz;
+
+		uint64_t limit;
+		if (tempFd >= 0 && tempCriticalFd >= 0 && readSysfsNumber(tempFd, value) && readSysfsNumber(tempCriticalFd, limit) && limit > amdgpuCriticalTempMargin)
+			sample.throttled = value >= limit - amdgpuCriticalTempMargin;
+		return true;
+	}
+
+	bool readProcessVram(uint32_t processId, uint64_t &vramUsedBytes) override
+	{
+		return readProcessDrmVram(processId, pdev, vramUsedBytes);
+	}
+
+private:
+	AmdgpuTelemetry() = default;
+
+	/// Highest shader clock level in pp_dpm_sclk ("1: 2500Mhz *"), 0 if unknown
+	static int readMaxClockMHz(const std::string &path)
+	{
+		std::ifstream file(path);
+		std::string level;
+		int maxClock = 0;
+		while (std::getline(file, level))
+		{
+			size_t colon = level.find(':');
+			if (colon != std::string::npos)
+				maxClock = std::max(maxClock, std::atoi(level.c_str() + colon + 1));
+		}
+		return maxClock;
+	}
+
+	int card = 0;
+	char pdev[16] = {};
+	int maxClockMHz = 0;
+	int vramUsedFd = -1;
+	int vramTotalFd = -1;
+	int busyFd = -1;
+	int clockFd = -1;
+	int tempFd = -1;
+	int tempCriticalFd = -1;
+};
+#endif
+#pragma endregion
+
+std::unique_ptr<GpuTelemetry> createGpuTelemetry(int gpuIndex)
+{
+	int nvidiaCount = 0;
+	if (std::unique_ptr<GpuTelemetry> nvml = NvmlTelemetry::create(gpuIndex, nvidiaCount))
+		return nvml;
+
+#ifndef _WIN32
+	// AMD GPUs are numbered after the NVIDIA ones
+	if (std::unique_ptr<GpuTelemetry> amdgpu = AmdgpuTelemetry::create(gpuIndex - nvidiaCount))
+		return amdgpu;
+#endif
+
+	return nullptr;
+}
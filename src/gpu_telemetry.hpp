@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class VrRuntime;
+
+/// What a GPU telemetry backend reports
+struct GpuTelemetrySample
+{
+	uint64_t vramUsedBytes = 0;
+	uint64_t vramTotalBytes = 0;
+	// Percentage of time the GPU was busy (0-100), -1 if unknown
+	int utilization = -1;
+	// Graphics clock and its maximum in MHz, 0 if unknown
+	int clockMHz = 0;
+	int maxClockMHz = 0;
+	// Whether the GPU is slowed down by its temperature or by hardware (not by reaching its power cap under load)
+	bool throttled = false;
+};
+
+/**
+ * Reads the state of a GPU (VRAM usage, utilisation, clocks and throttling) from whatever the driver exposes.
+ * Backends are created ready to read and release the driver when destroyed.
+ */
+class GpuTelemetry
+{
+public:
+	virtual ~GpuTelemetry() = default;
+
+	/// Backend and device, for logs (e.g. "NVML, GPU 0")
+	virtual std::string getName() = 0;
+
+	/// Reads the current values, returns false if the GPU can't be read anymore
+	virtual bool read(GpuTelemetrySample &sample) = 0;
+
+	/// VRAM used on this GPU by a single process, returns false if unknown
+	virtual bool readProcessVram(uint32_t, uint64_t &)
+	{
+		return false;
+	}
+};
+
+/**
+ * Telemetry of the GPU at gpuIndex, nullptr if there's none.
+ * GPUs are numbered across backends: NVIDIA GPUs (NVML) first, then AMD GPUs (amdgpu sysfs, Linux only).
+ * Per-process VRAM is only known for AMD GPUs (DRM fdinfo).
+ */
+std::unique_ptr<GpuTelemetry> createGpuTelemetry(int gpuIndex);
+
+/// Telemetry of the GPU simulated by a runtime created with createFakeVrRuntime
+std::unique_ptr<GpuTelemetry> createFakeGpuTelemetry(VrRuntime &fakeVrRuntime);
@@ -1,10 +1,14 @@
+#include <atomic>
 #include <chrono>
 #include <set>
-#include <sstream>
 #include <thread>
 #include <cstdlib>
 #include <algorithm>
 #include <filesystem>
+#include <fstream>
+#include <ctime>
+#include <iterator>
+#include <cmath>
 
 // OpenVR to interact with VR
 #include <openvr.h>
@@ -12,17 +16,38 @@
 // fmt for text formatting
 #include <fmt/core.h>
 
-// To include the nvml library at runtime
+// WinMain
 #ifdef _WIN32
 #define NOMINMAX
 #include <Windows.h>
-#else
-#include <dlfcn.h>
 #endif
 
 // Loading and saving .ini configuration file
 #include "SimpleIni.h"
-#include "setup.hpp"
+#include "settings_schema.hpp"
+
+// OpenVR, or a fake runtime to run without SteamVR
+#include "vr_runtime.hpp"
+
+// VRAM usage (NVML, amdgpu)
+#include "gpu_telemetry.hpp"
+
+// OpenMetrics endpoint
+#include "metrics_server.hpp"
+
+// Local control API
+#include "control_server.hpp"
+
+// Reloading settings.ini when it's edited
+#include "settings_watcher.hpp"
+
+// Resolution controller
+#include "app_profiles.hpp"
+#include "controller.hpp"
+#include "frame_trace.hpp"
+#include "metric_history.hpp"
+#include "spsc_queue.hpp"
+#include "triple_buffer.hpp"
 
 // Dear ImGui
 #include "imgui.h"
@@ -36,10 +61,6 @@
 // Tray icon
 #include "tray.h"
 
-#ifndef WIN32
-#define HMODULE void *
-#endif
-
 #pragma region Modify InputText so we can use std::string
 namespace ImGui
 {
@@ -58,255 +79,258 @@ static constexpr const char *version = "v1.4.0";
 
 static constexpr const char *iconPath = "icon.png";
 
+static constexpr const char *logPath = "ovrdr.log";
+
+static constexpr const char *settingsPath = "settings.ini";
+
+// Learned per-app resolutions, next to settings.ini
+static constexpr const char *appProfilesPath = "profiles.bin";
+
+// Control API socket, next to settings.ini
+static constexpr const char *controlSocketPath = "ovrdr.sock";
+
 static constexpr const std::chrono::milliseconds refreshIntervalBackground = 167ms; // 6fps
 static constexpr const std::chrono::milliseconds refreshIntervalFocused = 33ms;		// 30fps
 
+// How long the GUI keeps redrawing after input (hover effects, tooltips, etc.)
+static constexpr const long guiInputRedrawMs = 1000;
+
 static constexpr const int mainWindowWidth = 350;
 static constexpr const int mainWindowHeight = 304;
 
 static constexpr const float bitsToGB = 1073741824;
 
-static constexpr const int openvrMaxFrames = 128;
+static constexpr const int frameFetchMargin = 4;
+
+static constexpr const std::chrono::milliseconds controllerSampleInterval = 50ms;
+
+static constexpr const int commandQueueSize = 64;
 
-static constexpr const int maxReprojectionCount = 3;
+// Metric points waiting for the GUI (about 25 seconds)
+static constexpr const int metricQueueSize = 256;
+
+// Graph window lengths (in seconds) to choose from
+static constexpr const int graphWindowCount = 5;
+static constexpr const int graphWindowLengths[graphWindowCount] = {30, 60, 300, 600, 1800};
+static constexpr const char *graphWindowNames[graphWindowCount] = {"30 s", "1 min", "5 min", "10 min", "30 min"};
+static constexpr const float graphHeight = 52;
+// One column per pixel of the graph's width
+static constexpr const int graphMaxColumns = mainWindowWidth;
+
+// Frametime statistics served by the metrics endpoint
+static constexpr const int metricsEstimatorCount = 4;
+static constexpr const int metricsEstimators[metricsEstimatorCount] = {FrametimeEstimator_Mean, FrametimeEstimator_Median, FrametimeEstimator_P90, FrametimeEstimator_P99};
+static constexpr const char *metricsEstimatorNames[metricsEstimatorCount] = {"mean", "p50", "p90", "p99"};
 
 GLFWwindow *glfwWindow;
 
+std::unique_ptr<VrRuntime> vrRuntime;
+
+// Null if VRAM isn't monitored
+std::unique_ptr<GpuTelemetry> gpuTelemetry;
+
+// Null if metrics aren't served
+std::unique_ptr<MetricsServer> metricsServer;
+
+// Null if the control API is disabled
+std::unique_ptr<ControlServer> controlServer;
+
+// Null if settings.ini can't be watched
+std::unique_ptr<SettingsWatcher> settingsWatcher;
+
+// Recent frametimes, resolution and VRAM usage for the graphs (only touched by the GUI thread)
+MetricHistory metricHistory;
+
 bool trayQuit = false;
 
+// Whether this run has no window, decided at startup (the headless setting only applies to the next one)
+bool runHeadless = false;
+
+long lastGuiInputTime = 0;
+
 #pragma region Config
-#pragma region Default settings
+#pragma region Settings
+// Defaults, ranges and GUI widgets are in settingSchema (ControllerSettings has the resolution controller's defaults)
 // Initialization
-bool autoStart = true;
-int minimizeOnStart = 1;
+bool autoStart;
+int minimizeOnStart;
+bool headless;
 // General
-bool closeToTray = false;
-bool externalResChangeCompatibility = true;
-std::string blacklistApps = "steam.app.620980 steam.app.658920 steam.app.2177750 steam.app.2177760";
-std::set<std::string> blacklistAppsSet = {"steam.app.620980", "steam.app.658920", "steam.app.2177750", "steam.app.2177760"};
-bool whitelistEnabled = false;
-std::string whitelistApps = "";
-std::set<std::string> whitelistAppsSet = {};
-// Resolution
-int resChangeDelayMs = 6000;
-int initialRes = 100;
-int minRes = 70;
-int maxRes = 190;
-float resIncreaseThreshold = 79;
-float resDecreaseThreshold = 89;
-int resIncreaseMin = 2;
-int resDecreaseMin = 3;
-int resIncreaseScale = 200;
-int resDecreaseScale = 180;
-float minCpuTimeThreshold = 0.6f;
-bool resetOnThreshold = true;
-// Reprojection
-int alwaysReproject = 0;
-bool preferReprojection = false;
-bool ignoreCpuTime = false;
+bool closeToTray;
+// Newline-separated, as edited in the GUI
+std::string blacklistApps;
+std::string whitelistApps;
 // VRAM
-int vramTarget = 80;
-int vramLimit = 90;
-bool vramMonitorEnabled = true;
-bool vramOnlyMode = false;
-int gpuIndex = 0;
-// Debug
-bool debugEnabled = false;
-float debugGpuFrametime = 10.0f;
-float debugCpuFrametime = 10.0f;
-float debugVramUsage = 0.5f;
+bool vramMonitorEnabled;
+int gpuIndex;
+// Graphs
+int graphWindowSeconds;
+// Metrics
+bool metricsEnabled;
+int metricsPort;
+// Control API
+bool controlEnabled;
+// Resolution controller
+ControllerSettings settings;
+// [App:] sections, applied by the controller thread over settings
+std::vector<AppOverride> appOverrides;
 #pragma endregion
 
-/// Newline-delimited string to a set
-std::set<std::string> multilineStringToSet(const std::string &val)
-{
-	std::set<std::string> set;
-	std::stringstream ss(val);
-	std::string word;
+#pragma region Settings schema
+static constexpr const char *minimizeOnStartNames[] = {"Visible", "Minimized (taskbar)", "Hidden (tray)"};
 
-	for (std::string line; std::getline(ss, line, '\n');)
-		set.insert(line);
+/// Every setting saved in settings.ini, in the order they're saved (the per-app ones can also be set in [App:] sections)
+static constexpr const Setting settingSchema[] = {
+	// Startup
+	boolSetting("Startup", "autoStart", &autoStart, true, "Start with SteamVR", "Automatically launch OVRDR alongside SteamVR."),
+	choiceSetting("Startup", "minimizeOnStart", &minimizeOnStart, 1, minimizeOnStartNames, 3, "Window startup behaviour:", "Visible keeps the OVRDR window visible on startup, Minimized minimizes it to the taskbar and Hidden hides it completely. You can still show a hidden window by clicking \"Show\" in the tray icon's context menu.", SettingWidget_Radio),
+	boolSetting("Startup", "headless", &headless, false, "Headless mode", "Run without any window or graphics context on next startup, to leave the GPU entirely to the game. Messages are written to ovrdr.log instead. Can also be enabled with the --headless command line argument. Set headless=0 in settings.ini to get the window back."),
 
-	return set;
-}
+	// General
+	boolSetting("General", "closeToTray", &closeToTray, false, "Close to tray", "Minimize the window to the tray when closing it instead of closing the application."),
+	boolSetting("General", "externalResChangeCompatibility", settings, &ControllerSettings::externalResChangeCompatibility, "External res change compatibility", "Automatically switch to manual resolution adjustment within the app when VR resolution is changed from an external source (SteamVR setting, Oyasumi, etc.) as to let the external source control the resolution. Automatically switches back to dynamic resolution adjustment when resolution is set to automatic."),
+	appListSetting("General", "disabledApps", &blacklistApps, settings, &ControllerSettings::blacklistAppsSet, "Blacklisted apps", "List of OpenVR application keys that should be blacklisted for resolution adjustment in the format \'steam.app.APPID\' (e.g. \'steam.app.620980\' for Beat Saber). One per line."),
+	boolSetting("General", "whitelistEnabled", settings, &ControllerSettings::whitelistEnabled, "Enable whitelist", "Only allow resolution changes in whitelisted applications."),
+	appListSetting("General", "whitelistApps", &whitelistApps, settings, &ControllerSettings::whitelistAppsSet, "Whitelisted apps", "List of OpenVR application keys that should be whitelisted for resolution adjustment in the format \'steam.app.APPID\' (e.g. \'steam.app.620980\' for Beat Saber). One per line."),
 
-/// Set to a space-delimited string
-std::string setToConfigString(std::set<std::string> &valSet)
-{
-	std::string result;
+	// Resolution
+	perAppSetting(intSetting("General", "resChangeDelayMs", settings, &ControllerSettings::resChangeDelayMs, 100, settingNoLimit, 100, "Resolution change delay ms", "Delay in milliseconds between resolution changes. With an adaptive delay, this is the delay once the framerate is within the FPS targets.")),
+	perAppSetting(boolSetting("General", "adaptiveResChangeDelay", settings, &ControllerSettings::adaptiveResChangeDelay, "Adaptive resolution change delay", "Change resolution sooner when the framerate is far from the FPS targets or getting worse, so overloads are handled within a fraction of a second.")),
+	perAppSetting(intSetting("General", "resChangeDelayMinMs", settings, &ControllerSettings::resChangeDelayMinMs, 100, settingNoLimit, 50, "Minimum resolution change delay ms", "Shortest delay in milliseconds between resolution changes, used when the framerate is far from the FPS targets.")),
+	perAppSetting(boolSetting("General", "emergencyDownscale", settings, &ControllerSettings::emergencyDownscale, "Emergency downscale", "Lower resolution right away, without waiting for the resolution change delay, when most frames miss the refresh rate for a few hundred milliseconds (e.g. a heavy scene loading in). Single-frame hitches are ignored.")),
+	perAppSetting(intSetting("General", "emergencyMaxCut", settings, &ControllerSettings::emergencyMaxCut, 0, 100, 5, "Emergency downscale max", "The most resolution can be lowered by at once by an emergency downscale (in percent).")),
+	perAppSetting(intSetting("Resolution", "initialRes", settings, &ControllerSettings::initialRes, 20, 500, 5, "Initial resolution", "The resolution set at startup. Also used when resetting resolution.")),
+	perAppSetting(intSetting("Resolution", "minRes", settings, &ControllerSettings::minRes, 20, 500, 5, "Minimum resolution", "The minimum resolution OVRDR will set.")),
+	perAppSetting(intSetting("Resolution", "maxRes", settings, &ControllerSettings::maxRes, 20, 500, 5, "Maximum resolution", "The maximum resolution OVRDR will set.")),
+	perAppSetting(boolSetting("Resolution", "appProfiles", settings, &ControllerSettings::appProfiles, "Remember resolution per app", "Start each application at the resolution it settled on last time instead of the initial resolution. Learned resolutions are saved in profiles.bin.")),
+	// Edited as FPS targets
+	perAppSetting(floatSetting("Resolution", "resIncreaseThreshold", settings, &ControllerSettings::resIncreaseThreshold, 0, settingNoLimit, 0, nullptr, nullptr)),
+	perAppSetting(floatSetting("Resolution", "resDecreaseThreshold", settings, &ControllerSettings::resDecreaseThreshold, 0, settingNoLimit, 0, nullptr, nullptr)),
+	perAppSetting(intSetting("Resolution", "resIncreaseMin", settings, &ControllerSettings::resIncreaseMin, -settingNoLimit, settingNoLimit, 1, "Resolution increase constant", "Constant percentages to increase resolution when available.")),
+	perAppSetting(intSetting("Resolution", "resDecreaseMin", settings, &ControllerSettings::resDecreaseMin, -settingNoLimit, settingNoLimit, 1, "Resolution decrease constant", "Constant percentages to decrease resolution when needed.")),
+	perAppSetting(intSetting("Resolution", "resIncreaseScale", settings, &ControllerSettings::resIncreaseScale, -settingNoLimit, settingNoLimit, 10, "Resolution increase scale", "The more frametime headroom and the higher this value is, the more resolution will increase each time.")),
+	perAppSetting(intSetting("Resolution", "resDecreaseScale", settings, &ControllerSettings::resDecreaseScale, -settingNoLimit, settingNoLimit, 10, "Resolution decrease scale", "The more frametime excess and the higher this value is, the more resolution will decrease each time.")),
+	perAppSetting(floatSetting("Resolution", "minCpuTimeThreshold", settings, &ControllerSettings::minCpuTimeThreshold, -settingNoLimit, settingNoLimit, 0.1f, "Minimum CPU time threshold", "Don't increase resolution if the CPU frametime is below this value (useful to prevent resolution increases during loading screens).")),
+	perAppSetting(boolSetting("Resolution", "resetOnThreshold", settings, &ControllerSettings::resetOnThreshold, "Reset on CPU time threshold", "Reset the resolution to the initial resolution whenever the \"Minimum CPU time threshold\" is met.")),
+	perAppSetting(choiceSetting("Resolution", "frametimeEstimator", settings, &ControllerSettings::frametimeEstimator, frametimeEstimatorNames, FrametimeEstimator_Count, "Frametime statistic", "How the frametimes of the last frames are summarized. The mean can hide a few slow frames, higher percentiles (e.g. p99 for 1% lows) make resolution react to them. The trimmed mean ignores the 10% fastest and slowest frames.")),
+	perAppSetting(boolSetting("Resolution", "bottleneckAware", settings, &ControllerSettings::bottleneckAware, "Bottleneck aware", "Only lower resolution when the GPU (or the compositor) is what limits the framerate, and only raise it when the GPU has time to spare. Resolution doesn't help when the application's CPU work, its own frame cap or mis-presented frames are the problem.")),
+	perAppSetting(choiceSetting("Resolution", "controllerMode", settings, &ControllerSettings::controllerMode, controllerModeNames, ControllerMode_Count, "Controller", "How resolution is adjusted. Step changes resolution by a few percentages each time the framerate is outside of the FPS targets. PID aims for the middle of the FPS targets and settles faster after load changes. Model learns how GPU frametime scales with resolution and directly sets the resolution expected to hit the middle of the FPS targets.")),
+	perAppSetting(floatSetting("Resolution", "pidKp", settings, &ControllerSettings::pidKp, 0, settingNoLimit, 0.1f, "PID proportional gain", "Resolution percentages changed per millisecond of GPU frametime away from the target.")),
+	perAppSetting(floatSetting("Resolution", "pidKi", settings, &ControllerSettings::pidKi, 0, settingNoLimit, 0.05f, "PID integral gain", "Resolution percentages changed per millisecond of GPU frametime away from the target, per second it stays there. Removes the remaining error over time.")),
+	perAppSetting(floatSetting("Resolution", "pidKd", settings, &ControllerSettings::pidKd, 0, settingNoLimit, 0.1f, "PID derivative gain", "Resolution percentages changed per millisecond per second of GPU frametime change. Dampens overshoot after load changes.")),
+	perAppSetting(floatSetting("Resolution", "pidDerivativeFilter", settings, &ControllerSettings::pidDerivativeFilter, 0, settingNoLimit, 0.5f, "PID derivative smoothing", "Time in seconds over which GPU frametime changes are smoothed before being used by the derivative gain, so noise doesn't make resolution jump around.")),
+	perAppSetting(floatSetting("Resolution", "modelForgetting", settings, &ControllerSettings::modelForgetting, 0.5f, 1.0f, 0.05f, "Model memory", "How much of what was learned about the GPU frametime is kept each resolution change (0.5-1). Lower adapts faster to scene changes, higher is steadier.")),
 
-	for (std::string val : valSet)
-	{
-		result += (val + " ");
-	}
-	if (!result.empty())
-	{
-		// remove trailing space
-		result.pop_back();
-	}
+	// Reprojection
+	perAppSetting(intSetting("Reprojection", "alwaysReproject", settings, &ControllerSettings::alwaysReproject, 0, maxReprojectionCount, 1, "Minimum reprojection", "Always scale the target frametime at least according to this factor.")),
+	perAppSetting(boolSetting("Reprojection", "preferReprojection", settings, &ControllerSettings::preferReprojection, "Prefer reprojection", "If enabled, scale the target frametime as soon as the CPU frametime is over the initial target frametime. Else, only scale the target frametime if the CPU frametime is over double, triple, etc. the initial target frametime.")),
+	perAppSetting(boolSetting("Reprojection", "ignoreCpuTime", settings, &ControllerSettings::ignoreCpuTime, "Never reproject", "Never scale the target frametime depending on the CPU frametime (stops both behaviours described in \"Prefer reprojection\" tooltip; \"Minimum reprojection\" will still work).")),
+
+	// VRAM
+	boolSetting("VRAM", "vramMonitorEnabled", &vramMonitorEnabled, true, "VRAM monitor enabled", "Enable VRAM specific features. If disabled, it is assumed that free VRAM is always available."),
+	perAppSetting(boolSetting("VRAM", "vramOnlyMode", settings, &ControllerSettings::vramOnlyMode, "VRAM-only mode", "Always stay at the initial resolution or lower based off available VRAM alone (ignoring frametimes).")),
+	perAppSetting(intSetting("VRAM", "vramTarget", settings, &ControllerSettings::vramTarget, 0, 100, 2, "VRAM target", "Resolution stops increasing once VRAM usage exceeds this percentage.")),
+	perAppSetting(intSetting("VRAM", "vramLimit", settings, &ControllerSettings::vramLimit, 0, 100, 2, "VRAM limit", "Resolution starts descreasing once VRAM usage exceeds this percentage.")),
+	perAppSetting(boolSetting("VRAM", "vramAppOnly", settings, &ControllerSettings::vramAppOnly, "Only count the app's VRAM", "Compare the VRAM used by the VR application (plus the headroom below) to the target and limit instead of the VRAM used by every application. Only works on AMD GPUs on Linux, the whole GPU's usage is used otherwise.")),
+	perAppSetting(floatSetting("VRAM", "vramHeadroomGB", settings, &ControllerSettings::vramHeadroomGB, 0, settingNoLimit, 0.25f, "VRAM headroom", "VRAM left for everything but the VR application (SteamVR, the desktop, overlays) when only counting the app's VRAM.", "%.2f GB")),
+	intSetting("VRAM", "gpuIndex", &gpuIndex, 0, 0, settingNoLimit, 1, "GPU Index", "The index of the GPU to use for VRAM monitoring (NVIDIA GPUs first, then AMD GPUs). Only useful in systems with multiple GPUs. Needs restart to take effect."),
+
+	// GPU
+	perAppSetting(boolSetting("GPU", "holdWhenThrottled", settings, &ControllerSettings::holdWhenThrottled, "Hold when throttled", "Don't increase resolution while the GPU is slowed down by its temperature or a hardware slowdown, as it has no headroom left even if frametimes say otherwise. Reaching the power limit under load doesn't count. Needs the VRAM monitor enabled.")),
+	perAppSetting(intSetting("GPU", "gpuBusyLimit", settings, &ControllerSettings::gpuBusyLimit, 0, 100, 1, "GPU busy limit", "Don't increase resolution while the GPU is busy more than this percentage of the time (100 to disable). Needs the VRAM monitor enabled.")),
 
-	return result;
+	// Graphs (chosen in the graphs window)
+	intSetting("Graphs", "graphWindowSeconds", &graphWindowSeconds, 60, graphWindowLengths[0], graphWindowLengths[graphWindowCount - 1], 0, nullptr, nullptr),
+
+	// Metrics
+	boolSetting("Metrics", "metricsEnabled", &metricsEnabled, false, "Serve metrics", "Serve the current state (framerate, frametimes, resolution, VRAM usage, resolution changes) in the OpenMetrics format at http://127.0.0.1:<port>/metrics, to be scraped by Prometheus or similar. Only reachable from this computer. Needs restart to take effect."),
+	intSetting("Metrics", "metricsPort", &metricsPort, 9788, 1, 65535, 1, "Metrics port", "TCP port the metrics are served on. Needs restart to take effect."),
+
+	// Control API
+	boolSetting("Control", "controlEnabled", &controlEnabled, false, "Enable control API", "Let scripts and launchers read the current state and pause, resume or set the resolution through the ovrdr.sock socket next to settings.ini (see the README). Needs restart to take effect."),
+
+	// Debug
+	boolSetting("Debug", "debugEnabled", settings, &ControllerSettings::debugEnabled, "Debug Enabled", "Enable debug features. Can be used to test configs and for development. This should not be enabled during normal use."),
+	floatSetting("Debug", "debugGpuFrametime", settings, &ControllerSettings::debugGpuFrametime, -settingNoLimit, settingNoLimit, 0.5f, "GPU Frametime", "Overrides the actual GPU frametime by this value when debug is enabled."),
+	floatSetting("Debug", "debugCpuFrametime", settings, &ControllerSettings::debugCpuFrametime, -settingNoLimit, settingNoLimit, 0.5f, "CPU Frametime", "Overrides the actual CPU frametime by this value when debug is enabled."),
+	floatSetting("Debug", "debugVramUsage", settings, &ControllerSettings::debugVramUsage, -settingNoLimit, settingNoLimit, 0.01f, "VRAM Usage", "Overrides the actual VRAM usage by this value (0.5 = 50% VRAM usage) when debug is enabled."),
+	boolSetting("Debug", "traceEnabled", settings, &ControllerSettings::traceEnabled, "Record frame trace", "Record the timings of every frame along with the resolution and VRAM usage to a trace-*.ovrt file, to look into resolution issues. Can be converted to CSV with ovrdr_trace_to_csv. Doesn't need debug to be enabled."),
+	intSetting("Debug", "traceMaxMB", settings, &ControllerSettings::traceMaxMB, 1, 4096, 16, "Frame trace size limit MB", "Space reserved for a trace, recording stops when it's full. A frame takes 40 bytes (about 13 MB per hour at 90 hz)."),
+};
+
+static constexpr const int settingCount = sizeof(settingSchema) / sizeof(settingSchema[0]);
+
+/// Index of a setting in settingSchema by key (an unknown key doesn't compile when used as a template argument)
+constexpr int settingIndex(const char *key)
+{
+	return findSetting(settingSchema, settingCount, key);
 }
+#pragma endregion
+
+// Settings as in settings.ini when it was last loaded or saved, to tell which ones get edited in the file
+SettingValue fileSettingValues[settingCount];
 
 bool loadSettings()
 {
 	// Get ini file
 	CSimpleIniA ini;
-	SI_Error rc = ini.LoadFile("settings.ini");
+	SI_Error rc = ini.LoadFile(settingsPath);
 	if (rc < 0)
 		return false;
 
-	try
-	{
-		// Startup
-		autoStart = std::stoi(ini.GetValue("Startup", "autoStart", std::to_string(autoStart).c_str()));
-		minimizeOnStart = std::stoi(ini.GetValue("Startup", "minimizeOnStart", std::to_string(minimizeOnStart).c_str()));
-
-		// General
-		closeToTray = std::stoi(ini.GetValue("General", "closeToTray", std::to_string(closeToTray).c_str()));
-		externalResChangeCompatibility = std::stoi(ini.GetValue("General", "externalResChangeCompatibility", std::to_string(externalResChangeCompatibility).c_str()));
-		// blacklist
-		blacklistApps = ini.GetValue("General", "disabledApps", blacklistApps.c_str());
-		std::replace(blacklistApps.begin(), blacklistApps.end(), ' ', '\n');
-		blacklistAppsSet = multilineStringToSet(blacklistApps);
-		// whitelist
-		whitelistEnabled = std::stoi(ini.GetValue("General", "whitelistEnabled", std::to_string(whitelistEnabled).c_str()));
-		whitelistApps = ini.GetValue("General", "whitelistApps", blacklistApps.c_str());
-		std::replace(whitelistApps.begin(), whitelistApps.end(), ' ', '\n');
-		whitelistAppsSet = multilineStringToSet(whitelistApps);
-
-		// Resolution
-		resChangeDelayMs = std::stoi(ini.GetValue("General", "resChangeDelayMs", std::to_string(resChangeDelayMs).c_str()));
-		initialRes = std::stoi(ini.GetValue("Resolution", "initialRes", std::to_string(initialRes).c_str()));
-		minRes = std::stoi(ini.GetValue("Resolution", "minRes", std::to_string(minRes).c_str()));
-		maxRes = std::stoi(ini.GetValue("Resolution", "maxRes", std::to_string(maxRes).c_str()));
-		resIncreaseThreshold = std::stof(ini.GetValue("Resolution", "resIncreaseThreshold", std::to_string(resIncreaseThreshold).c_str()));
-		resDecreaseThreshold = std::stof(ini.GetValue("Resolution", "resDecreaseThreshold", std::to_string(resDecreaseThreshold).c_str()));
-		resIncreaseMin = std::stoi(ini.GetValue("Resolution", "resIncreaseMin", std::to_string(resIncreaseMin).c_str()));
-		resDecreaseMin = std::stoi(ini.GetValue("Resolution", "resDecreaseMin", std::to_string(resDecreaseMin).c_str()));
-		resIncreaseScale = std::stoi(ini.GetValue("Resolution", "resIncreaseScale", std::to_string(resIncreaseScale).c_str()));
-		resDecreaseScale = std::stoi(ini.GetValue("Resolution", "resDecreaseScale", std::to_string(resDecreaseScale).c_str()));
-		minCpuTimeThreshold = std::stof(ini.GetValue("Resolution", "minCpuTimeThreshold", std::to_string(minCpuTimeThreshold).c_str()));
-		resetOnThreshold = std::stoi(ini.GetValue("Resolution", "resetOnThreshold", std::to_string(resetOnThreshold).c_str()));
-
-		// Reprojection
-		alwaysReproject = std::stoi(ini.GetValue("Reprojection", "alwaysReproject", std::to_string(alwaysReproject).c_str()));
-		preferReprojection = std::stoi(ini.GetValue("Reprojection", "preferReprojection", std::to_string(preferReprojection).c_str()));
-		ignoreCpuTime = std::stoi(ini.GetValue("Reprojection", "ignoreCpuTime", std::to_string(ignoreCpuTime).c_str()));
-
-		// VRAM
-		vramMonitorEnabled = std::stoi(ini.GetValue("VRAM", "vramMonitorEnabled", std::to_string(vramMonitorEnabled).c_str()));
-		vramOnlyMode = std::stoi(ini.GetValue("VRAM", "vramOnlyMode", std::to_string(vramOnlyMode).c_str()));
-		vramTarget = std::stoi(ini.GetValue("VRAM", "vramTarget", std::to_string(vramTarget).c_str()));
-		vramLimit = std::stoi(ini.GetValue("VRAM", "vramLimit", std::to_string(vramLimit).c_str()));
-		gpuIndex = std::stoi(ini.GetValue("VRAM", "gpuIndex", std::to_string(gpuIndex).c_str()));
-
-		// Debug
-		debugEnabled = std::stoi(ini.GetValue("Debug", "debugEnabled", std::to_string(debugEnabled).c_str()));
-		debugGpuFrametime = std::stof(ini.GetValue("Debug", "debugGpuFrametime", std::to_string(debugGpuFrametime).c_str()));
-		debugCpuFrametime = std::stof(ini.GetValue("Debug", "debugCpuFrametime", std::to_string(debugCpuFrametime).c_str()));
-		debugVramUsage = std::stof(ini.GetValue("Debug", "debugVramUsage", std::to_string(debugVramUsage).c_str()));
-
-		return true;
-	}
-	catch (...)
+	readSettings(ini, settingSchema, settingCount);
+	saveSettingValues(ini, settingSchema, settingCount, fileSettingValues);
+	appOverrides = readAppOverrides(ini, settingSchema, settingCount);
+	return true;
+}
+
+/**
+ * Reads the settings edited in settings.ini since it was last loaded or saved, flagging the ones that changed in changed
+ * (other settings keep the values edited in the GUI). Returns how many changed, overridesChanged tells whether the [App:] sections did.
+ */
+int reloadSettings(bool (&changed)[settingCount], bool &overridesChanged)
+{
+	overridesChanged = false;
+	CSimpleIniA ini;
+	SI_Error rc = ini.LoadFile(settingsPath);
+	if (rc < 0)
+		return 0;
+
+	std::vector<AppOverride> newAppOverrides = readAppOverrides(ini, settingSchema, settingCount);
+	if (newAppOverrides != appOverrides)
 	{
-		return false;
+		appOverrides = newAppOverrides;
+		overridesChanged = true;
 	}
+	return readEditedSettings(ini, settingSchema, settingCount, fileSettingValues, changed);
 }
 
 void saveSettings()
 {
-	// Get ini file
+	// Keep the [App:] sections (and comments) of the current file
 	CSimpleIniA ini;
-
-	// Startup
-	ini.SetValue("Startup", "autoStart", std::to_string(autoStart).c_str());
-	ini.SetValue("Startup", "minimizeOnStart", std::to_string(minimizeOnStart).c_str());
-
-	// General
-	ini.SetValue("General", "closeToTray", std::to_string(closeToTray).c_str());
-	ini.SetValue("General", "externalResChangeCompatibility", std::to_string(externalResChangeCompatibility).c_str());
-	ini.SetValue("General", "disabledApps", setToConfigString(blacklistAppsSet).c_str());
-	ini.SetValue("General", "whitelistEnabled", std::to_string(whitelistEnabled).c_str());
-	ini.SetValue("General", "whitelistApps", setToConfigString(whitelistAppsSet).c_str());
-
-	// Resolution
-	ini.SetValue("General", "resChangeDelayMs", std::to_string(resChangeDelayMs).c_str());
-	ini.SetValue("Resolution", "initialRes", std::to_string(initialRes).c_str());
-	ini.SetValue("Resolution", "minRes", std::to_string(minRes).c_str());
-	ini.SetValue("Resolution", "maxRes", std::to_string(maxRes).c_str());
-	ini.SetValue("Resolution", "resIncreaseThreshold", std::to_string(resIncreaseThreshold).c_str());
-	ini.SetValue("Resolution", "resDecreaseThreshold", std::to_string(resDecreaseThreshold).c_str());
-	ini.SetValue("Resolution", "resIncreaseMin", std::to_string(resIncreaseMin).c_str());
-	ini.SetValue("Resolution", "resDecreaseMin", std::to_string(resDecreaseMin).c_str());
-	ini.SetValue("Resolution", "resIncreaseScale", std::to_string(resIncreaseScale).c_str());
-	ini.SetValue("Resolution", "resDecreaseScale", std::to_string(resDecreaseScale).c_str());
-	ini.SetValue("Resolution", "minCpuTimeThreshold", std::to_string(minCpuTimeThreshold).c_str());
-	ini.SetValue("Resolution", "resetOnThreshold", std::to_string(resetOnThreshold).c_str());
-
-	// Reprojection
-	ini.SetValue("Reprojection", "alwaysReproject", std::to_string(alwaysReproject).c_str());
-	ini.SetValue("Reprojection", "preferReprojection", std::to_string(preferReprojection).c_str());
-	ini.SetValue("Reprojection", "ignoreCpuTime", std::to_string(ignoreCpuTime).c_str());
-
-	// VRAM
-	ini.SetValue("VRAM", "vramMonitorEnabled", std::to_string(vramMonitorEnabled).c_str());
-	ini.SetValue("VRAM", "vramOnlyMode", std::to_string(vramOnlyMode).c_str());
-	ini.SetValue("VRAM", "vramTarget", std::to_string(vramTarget).c_str());
-	ini.SetValue("VRAM", "vramLimit", std::to_string(vramLimit).c_str());
-	ini.SetValue("VRAM", "gpuIndex", std::to_string(gpuIndex).c_str());
-
-	// Debug
-	ini.SetValue("Debug", "debugEnabled", std::to_string(debugEnabled).c_str());
-	ini.SetValue("Debug", "debugGpuFrametime", std::to_string(debugGpuFrametime).c_str());
-	ini.SetValue("Debug", "debugCpuFrametime", std::to_string(debugCpuFrametime).c_str());
-	ini.SetValue("Debug", "debugVramUsage", std::to_string(debugVramUsage).c_str());
+	ini.LoadFile(settingsPath);
+	writeSettings(ini, settingSchema, settingCount);
+	saveSettingValues(ini, settingSchema, settingCount, fileSettingValues);
 
 	// Save changes to disk
-	ini.SaveFile("settings.ini");
+	ini.SaveFile(settingsPath);
 }
 #pragma endregion
 
-#pragma region NVML
-bool nvmlEnabled = true;
-
-typedef enum nvmlReturn_enum
-{
-	NVML_SUCCESS = 0,					// The operation was successful.
-	NVML_ERROR_UNINITIALIZED = 1,		// NVML was not first initialized with nvmlInit.
-	NVML_ERROR_INVALID_ARGUMENT = 2,	// A supplied argument is invalid.
-	NVML_ERROR_NOT_SUPPORTED = 3,		// The requested operation is not available on target device.
-	NVML_ERROR_NO_PERMISSION = 4,		// The currrent user does not have permission for operation.
-	NVML_ERROR_ALREADY_INITIALIZED = 5, // NVML has already been initialized.
-	NVML_ERROR_NOT_FOUND = 6,			// A query to find an object was unccessful.
-	NVML_ERROR_UNKNOWN = 7,				// An internal driver error occurred.
-} nvmlReturn_t;
-typedef nvmlReturn_t (*nvmlInit_t)();
-typedef nvmlReturn_t (*nvmlShutdown_t)();
-typedef struct
-{
-	unsigned long long total;
-	unsigned long long free;
-	unsigned long long used;
-} nvmlMemory_t;
-typedef nvmlReturn_t (*nvmlDevice_t)();
-typedef nvmlReturn_t (*nvmlDeviceGetHandleByIndex_t)(unsigned int, nvmlDevice_t *);
-typedef nvmlReturn_t (*nvmlDeviceGetMemoryInfo_t)(nvmlDevice_t, nvmlMemory_t *);
-#ifdef _WIN32
-typedef HMODULE(nvmlLib);
-#else
-typedef void *(nvmlLib);
-#endif
-#pragma endregion
-
 long getCurrentTimeMillis()
 {
-	auto since_epoch = std::chrono::system_clock::now().time_since_epoch();
+	// Monotonic, only used to measure intervals
+	auto since_epoch = std::chrono::steady_clock::now().time_since_epoch();
 	auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch);
 	return millis.count();
 }
 
+void markGuiInput()
+{
+	lastGuiInputTime = getCurrentTimeMillis();
+}
+
 void pushGrayButtonColour()
 {
 	ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.12, 0.12, 0.12, 12));
@@ -328,47 +352,40 @@ void pushGreenButtonColour()
 	ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0.17, 0.68, 0.17, 1));
 }
 
-/**
- * Returns the current VR application key (steam.app.000000)
- * or an empty string if no app is running.
- */
-std::string getCurrentApplicationKey()
-{
-	char applicationKey[vr::k_unMaxApplicationKeyLength];
-
-	uint32_t processId = vr::VRApplications()->GetCurrentSceneProcessId();
-	if (!processId)
-		return "";
-
-	EVRApplicationError err = vr::VRApplications()->GetApplicationKeyByProcessId(processId, applicationKey, vr::k_unMaxApplicationKeyLength);
-	if (err)
-		return "";
-
-	return {applicationKey};
-}
-
-bool isApplicationBlacklisted(std::string appKey)
-{
-	return appKey == "" || blacklistAppsSet.find(appKey) != blacklistAppsSet.end();
-}
-
-bool isApplicationWhitelisted(std::string appKey)
+/// Local time of a timestamp (thread-safe, unlike std::localtime)
+std::tm toLocalTime(std::time_t time)
 {
-	return appKey != "" && whitelistAppsSet.find(appKey) != whitelistAppsSet.end();
+	std::tm local = {};
+#ifdef _WIN32
+	localtime_s(&local, &time);
+#else
+	localtime_r(&time, &local);
+#endif
+	return local;
 }
 
-bool shouldAdjustResolution(std::string appKey, bool manualRes, float cpuTime)
+/// Appends a timestamped line to the log file
+void logLine(const std::string &text)
 {
-	// Check if the SteamVR dashboard is open
-	bool inDashboard = vr::VROverlay()->IsDashboardVisible();
-	// Check that we're in a supported application
-	bool isCurrentAppSupported = !isApplicationBlacklisted(appKey) && (!whitelistEnabled || isApplicationWhitelisted(appKey));
-	// Only adjust resolution if not in dashboard, in a supported application. user didn't pause res and cpu time isn't below threshold
-	return !inDashboard && isCurrentAppSupported && !manualRes && !(resetOnThreshold && cpuTime < minCpuTimeThreshold);
+	std::ofstream log(logPath, std::ios::app);
+	if (!log)
+		return;
+
+	char timestamp[32];
+	std::tm now = toLocalTime(std::time(nullptr));
+	std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &now);
+	log << "[" << timestamp << "] " << text << "\n";
 }
 
 void printLine(std::string text, long duration)
 {
+	// No window to print to
+	if (runHeadless)
+	{
+		logLine(text);
+		return;
+	}
+
 	long startTime = getCurrentTimeMillis();
 
 	while (getCurrentTimeMillis() < startTime + duration && !glfwWindowShouldClose(glfwWindow))
@@ -404,37 +421,28 @@ void printLine(std::string text, long duration)
 	}
 }
 
-void cleanup(nvmlLib nvmlLibrary)
+void cleanup()
 {
 	// OpenVR cleanup
-	vr::VR_Shutdown();
+	vrRuntime->shutdown();
 
-	// NVML cleanup
-#ifdef _WIN32
-	nvmlShutdown_t nvmlShutdownPtr = (nvmlShutdown_t)GetProcAddress(nvmlLibrary, "nvmlShutdown");
-	if (nvmlShutdownPtr)
-	{
-		nvmlShutdownPtr();
-	}
-	FreeLibrary(nvmlLibrary);
-#else
-	if (nvmlEnabled)
-	{
-		nvmlShutdown_t nvmlShutdownPtr = (nvmlShutdown_t)dlsym(nvmlLibrary, "nvmlShutdown");
-		if (nvmlShutdownPtr)
-		{
-			nvmlShutdownPtr();
-		}
-		dlclose(nvmlLibrary);
-	}
-#endif
+	// GPU telemetry cleanup
+	gpuTelemetry.reset();
+
+	// Stop serving metrics and the control API
+	metricsServer.reset();
+	controlServer.reset();
+	settingsWatcher.reset();
 
 	// GUI cleanup
-	ImGui_ImplOpenGL3_Shutdown();
-	ImGui_ImplGlfw_Shutdown();
-	ImGui::DestroyContext();
-	glfwDestroyWindow(glfwWindow);
-	glfwTerminate();
+	if (!runHeadless)
+	{
+		ImGui_ImplOpenGL3_Shutdown();
+		ImGui_ImplGlfw_Shutdown();
+		ImGui::DestroyContext();
+		glfwDestroyWindow(glfwWindow);
+		glfwTerminate();
+	}
 }
 
 void addTooltip(const char *text)
@@ -450,821 +458,1466 @@ void addTooltip(const char *text)
 	}
 }
 
-std::string executable_path;
+/// Draws the widget of a setting described by its schema entry, returns true if it was edited (and then clamped to its range)
+bool drawSetting(const Setting &setting)
+{
+	bool edited = false;
+	switch (setting.widget)
+	{
+	case SettingWidget_None:
+		return false;
+	case SettingWidget_Checkbox:
+		edited = ImGui::Checkbox(setting.label, setting.boolValue);
+		break;
+	case SettingWidget_InputInt:
+		edited = ImGui::InputInt(setting.label, setting.intValue, (int)setting.step);
+		break;
+	case SettingWidget_InputFloat:
+		edited = ImGui::InputFloat(setting.label, setting.floatValue, setting.step, 0.0f, setting.format);
+		break;
+	case SettingWidget_Combo:
+		edited = ImGui::Combo(setting.label, setting.intValue, setting.names, setting.nameCount);
+		break;
+	case SettingWidget_Radio:
+		ImGui::Text("%s", setting.label);
+		addTooltip(setting.tooltip);
+		for (int i = 0; i < setting.nameCount; i++)
+			edited |= ImGui::RadioButton(setting.names[i], setting.intValue, i);
+		return edited;
+	case SettingWidget_AppList:
+		edited = ImGui::InputTextMultiline(setting.label, setting.textValue, ImVec2(130, 60), ImGuiInputTextFlags_CharsNoBlank);
+		if (edited)
+			*setting.setValue = multilineStringToSet(*setting.textValue);
+		break;
+	}
 
-std::string get_executable_path()
+	if (edited)
+		clampSetting(setting);
+	addTooltip(setting.tooltip);
+	return edited;
+}
+
+/// drawSetting of the setting at index in settingSchema (use settingIndex to check the key at compile time)
+template <int index>
+bool drawSetting()
 {
-	return executable_path;
+	static_assert(index >= 0, "Unknown setting key");
+	return drawSetting(settingSchema[index]);
 }
 
-int main(int argc, char *argv[])
+/// Edits a frametime threshold (a percentage of the HMD frametime) as an FPS target, returns true if it was edited
+bool inputFpsTarget(const char *label, float &threshold, float hmdHz)
 {
-	executable_path = argc > 0 ? std::filesystem::absolute(std::filesystem::path(argv[0])).string() : "";
+	int fps = threshold > 0 ? (int)std::round(hmdHz * 100.0f / threshold) : 0;
+	// The threshold can't be known until the refresh rate is
+	if (!ImGui::InputInt(label, &fps, 1) || fps <= 0 || hmdHz <= 0)
+		return false;
+	threshold = hmdHz / fps * 100.0f;
+	return true;
+}
 
-#pragma region GUI init
-	if (!glfwInit())
-		return 1;
+/**
+ * Draws series of the metric history over the last windowSeconds, filling the window's width.
+ * Each pixel column shows the lowest and highest values of its time span, so spikes stay visible at any window length.
+ * The graph goes from 0 to the highest value shown or minMax, whichever is higher.
+ */
+void drawMetricGraph(const MetricSeries *series, const ImU32 *colours, int seriesCount, int windowSeconds, float minMax, const char *unit)
+{
+	static float minValues[MetricSeries_Count][graphMaxColumns];
+	static float maxValues[MetricSeries_Count][graphMaxColumns];
 
-	// GL 3.0 + GLSL 130
-	const char *glsl_version = "#version 130";
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	ImVec2 size(ImGui::GetContentRegionAvail().x, graphHeight);
+	ImGui::Dummy(size);
+	int columns = std::clamp((int)size.x, 1, graphMaxColumns);
+	int windowPoints = windowSeconds * 1000 / metricHistoryIntervalMs;
 
-	// Make window non-resizable
-	glfwWindowHint(GLFW_RESIZABLE, false);
+	float top = minMax;
+	for (int i = 0; i < seriesCount; i++)
+	{
+		metricHistory.decimate(series[i], windowPoints, columns, minValues[i], maxValues[i]);
+		top = std::max(top, *std::max_element(maxValues[i], maxValues[i] + columns));
+	}
+	top = top > 0 ? top * 1.1f : 1.0f;
+	float yScale = size.y / top;
 
-	// Create window with graphics context
-	glfwWindow = glfwCreateWindow(mainWindowWidth, mainWindowHeight, "OVR Dynamic Resolution", nullptr, nullptr);
-	if (glfwWindow == nullptr)
-		return 1;
-	glfwMakeContextCurrent(glfwWindow);
+	ImDrawList *drawList = ImGui::GetWindowDrawList();
+	drawList->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), ImGui::GetColorU32(ImGuiCol_FrameBg));
+	float bottom = origin.y + size.y;
+	for (int i = 0; i < seriesCount; i++)
+	{
+		for (int column = 0; column < columns; column++)
+		{
+			float low = minValues[i][column];
+			float high = maxValues[i][column];
+			// No data
+			if (low > high)
+				continue;
+			// Join the previous column so the line stays continuous
+			if (column > 0 && minValues[i][column - 1] <= maxValues[i][column - 1])
+			{
+				low = std::min(low, maxValues[i][column - 1]);
+				high = std::max(high, minValues[i][column - 1]);
+			}
+			float x = origin.x + column + 0.5f;
+			drawList->AddLine(ImVec2(x, bottom - low * yScale + 0.5f), ImVec2(x, bottom - high * yScale - 0.5f), colours[i]);
+		}
+	}
 
-	// Setup Dear ImGui context
-	IMGUI_CHECKVERSION();
-	ImGui::CreateContext();
-	ImGuiIO &io = ImGui::GetIO();
+	// Scale
+	drawList->AddText(ImVec2(origin.x + 2, origin.y), ImGui::GetColorU32(ImGuiCol_Text, 0.6f), fmt::format("{:.1f} {}", top, unit).c_str());
+}
 
-	// Don't save Dear ImGui window state
-	io.IniFilename = NULL;
+#pragma region Controller thread
+/// State published by the controller thread for the GUI
+struct ControllerSnapshot
+{
+	ControllerDecision decision;
+	uint32_t hmdWidthRes = 0;
+	uint32_t hmdHeightRes = 0;
+	bool vramMonitored = false;
+	float vramTotalGB = 0;
+	// GPU graphics clock in MHz, 0 if unknown
+	int gpuClockMHz = 0;
+	// Current VR application key (steam.app.000000), empty if no app is running
+	char appKey[vr::k_unMaxApplicationKeyLength] = {};
+	// Frames in the trace being recorded
+	uint32_t traceFrames = 0;
+	// Settings displayed alongside the state, as the controller uses them for the current application ([App:] overrides applied)
+	bool vramOnlyMode = false;
+	int vramTarget = 0;
+	int vramLimit = 0;
+	int frametimeEstimator = FrametimeEstimator_Mean;
+	int controllerMode = ControllerMode_Step;
+	int maxRes = 0;
+
+	// Frametime statistics of the last tick's frames (metricsEstimators, only filled when serving metrics)
+	float gpuTimes[metricsEstimatorCount] = {};
+	float cpuTimes[metricsEstimatorCount] = {};
+	// Resolution changes and controller ticks since startup, and how long the last tick took
+	uint32_t resolutionChanges = 0;
+	uint32_t ticks = 0;
+	float tickMs = 0;
+};
+
+enum ControllerCommandType
+{
+	ControllerCommand_SetManualRes,
+	ControllerCommand_SetResolution,
+	// Manual resolution at res, in one command so it can't be paused without the resolution being set
+	ControllerCommand_PinResolution,
+};
+
+/// Action requested by the GUI or the control API
+struct ControllerCommand
+{
+	ControllerCommandType type = ControllerCommand_SetManualRes;
+	bool manualRes = false;
+	float res = 0;
+};
 
-	// Setup Dear ImGui style
-	ImGui::StyleColorsDark();
-	ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(0.03, 0.03, 0.03, 1));
+/// Lock-free channels between the GUI and the controller thread
+struct ControllerChannels
+{
+	// Controller -> GUI
+	TripleBuffer<ControllerSnapshot> snapshots;
+	// GUI -> controller
+	TripleBuffer<ControllerSettings> settings;
+	TripleBuffer<std::vector<AppOverride>> appOverrides;
+	SpscQueue<ControllerCommand, commandQueueSize> commands;
+	// Controller -> GUI (graphs)
+	SpscQueue<MetricPoint, metricQueueSize> metrics;
+	// Controller -> metrics server
+	TripleBuffer<ControllerSnapshot> metricsSnapshots;
+	// Controller <-> control API
+	TripleBuffer<ControllerSnapshot> controlSnapshots;
+	SpscQueue<ControllerCommand, commandQueueSize> controlCommands;
+
+	std::atomic<bool> quit{false};
+	std::atomic<bool> openvrQuit{false};
+};
+
+/// Writes the TYPE and HELP lines of a metric
+void addOpenMetricsFamily(std::string &text, const char *name, const char *type, const char *help)
+{
+	fmt::format_to(std::back_inserter(text), "# TYPE {} {}\n# HELP {} {}\n", name, type, name, help);
+}
 
-	// Setup Platform/Renderer backends
-	ImGui_ImplGlfw_InitForOpenGL(glfwWindow, true);
-#ifdef __EMSCRIPTEN__
-	ImGui_ImplGlfw_InstallEmscriptenCallbacks(window, "#canvas");
-#endif
-	ImGui_ImplOpenGL3_Init(glsl_version);
+/// Renders the controller state as OpenMetrics text (reusing text's memory)
+void renderOpenMetrics(const ControllerSnapshot &snapshot, std::string &text)
+{
+	const ControllerDecision &decision = snapshot.decision;
+	auto out = std::back_inserter(text);
+	text.clear();
 
-	// Set window icon
-	GLFWimage icon;
-	unsigned iconWidth, iconHeight;
-	if (lodepng_decode32_file(&(icon.pixels), &(iconWidth), &(iconHeight), iconPath) == 0)
+	if (snapshot.appKey[0])
 	{
-		icon.width = (int)iconWidth;
-		icon.height = (int)iconHeight;
-		glfwSetWindowIcon(glfwWindow, 1, &icon);
+		addOpenMetricsFamily(text, "ovrdr_app", "info", "Current VR application.");
+		text += "ovrdr_app_info{key=\"";
+		for (const char *c = snapshot.appKey; *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				text += '\\';
+			text += *c;
+		}
+		text += "\"} 1\n";
 	}
-#pragma endregion
 
-#pragma region VR init
-	EVRInitError init_error;
-	std::unique_ptr<IVRSystem, decltype(&shutdown_vr)> system(
-		VR_Init(&init_error, VRApplication_Overlay), &shutdown_vr);
-	if (init_error)
-	{
-		system = nullptr;
-		printLine(VR_GetVRInitErrorAsEnglishDescription(init_error), 6000l);
-		return EXIT_FAILURE;
-	}
-	if (!VRCompositor())
-	{
-		printLine("Failed to initialize VR compositor.", 6000l);
-		return EXIT_FAILURE;
-	}
-#pragma endregion
+	addOpenMetricsFamily(text, "ovrdr_dynamic_resolution", "gauge", "Whether resolution is being adjusted dynamically.");
+	fmt::format_to(out, "ovrdr_dynamic_resolution {}\n", decision.adjustResolution ? 1 : 0);
 
-	// Load settings from ini file
-	if (!loadSettings())
+	addOpenMetricsFamily(text, "ovrdr_hmd_refresh_rate_hertz", "gauge", "Refresh rate of the headset.");
+	fmt::format_to(out, "ovrdr_hmd_refresh_rate_hertz {}\n", decision.hmdHz);
+
+	addOpenMetricsFamily(text, "ovrdr_fps", "gauge", "Displayed frames per second.");
+	fmt::format_to(out, "ovrdr_fps {}\n", decision.currentFps);
+
+	addOpenMetricsFamily(text, "ovrdr_target_fps", "gauge", "Framerate targets.");
+	fmt::format_to(out, "ovrdr_target_fps{{bound=\"low\"}} {}\novrdr_target_fps{{bound=\"high\"}} {}\n", decision.targetFpsLow, decision.targetFpsHigh);
+
+	addOpenMetricsFamily(text, "ovrdr_gpu_frametime_seconds", "gauge", "GPU frametime of the frames since the last resolution change.");
+	for (int i = 0; i < metricsEstimatorCount; i++)
+		fmt::format_to(out, "ovrdr_gpu_frametime_seconds{{stat=\"{}\"}} {}\n", metricsEstimatorNames[i], snapshot.gpuTimes[i] / 1000);
+
+	addOpenMetricsFamily(text, "ovrdr_cpu_frametime_seconds", "gauge", "CPU frametime of the frames since the last resolution change.");
+	for (int i = 0; i < metricsEstimatorCount; i++)
+		fmt::format_to(out, "ovrdr_cpu_frametime_seconds{{stat=\"{}\"}} {}\n", metricsEstimatorNames[i], snapshot.cpuTimes[i] / 1000);
+
+	addOpenMetricsFamily(text, "ovrdr_reprojection_ratio", "gauge", "Average number of times each frame was reprojected.");
+	fmt::format_to(out, "ovrdr_reprojection_ratio {}\n", std::max(decision.averageFrameShown - 1, 0.0f));
+
+	addOpenMetricsFamily(text, "ovrdr_resolution_ratio", "gauge", "SteamVR resolution scale (1 = 100%).");
+	fmt::format_to(out, "ovrdr_resolution_ratio {}\n", decision.newRes / 100);
+
+	addOpenMetricsFamily(text, "ovrdr_render_target_width_pixels", "gauge", "Render target width per eye.");
+	fmt::format_to(out, "ovrdr_render_target_width_pixels {}\n", snapshot.hmdWidthRes);
+	addOpenMetricsFamily(text, "ovrdr_render_target_height_pixels", "gauge", "Render target height per eye.");
+	fmt::format_to(out, "ovrdr_render_target_height_pixels {}\n", snapshot.hmdHeightRes);
+
+	if (snapshot.vramMonitored)
 	{
-		std::replace(blacklistApps.begin(), blacklistApps.end(), ' ', '\n'); // Set blacklist newlines
-		saveSettings();														 // Restore settings
+		addOpenMetricsFamily(text, "ovrdr_vram_used_bytes", "gauge", "VRAM used on the GPU.");
+		fmt::format_to(out, "ovrdr_vram_used_bytes {:.0f}\n", (double)decision.vramUsedGB * bitsToGB);
+		addOpenMetricsFamily(text, "ovrdr_vram_total_bytes", "gauge", "VRAM of the GPU.");
+		fmt::format_to(out, "ovrdr_vram_total_bytes {:.0f}\n", (double)snapshot.vramTotalGB * bitsToGB);
+		if (decision.vramAppUsedGB > 0)
+		{
+			addOpenMetricsFamily(text, "ovrdr_vram_app_used_bytes", "gauge", "VRAM used by the VR application.");
+			fmt::format_to(out, "ovrdr_vram_app_used_bytes {:.0f}\n", (double)decision.vramAppUsedGB * bitsToGB);
+		}
 	}
 
-	// Set auto-start
-	int autoStartResult = handle_setup(autoStart);
-	if (autoStartResult != 0)
-		printLine(fmt::format("Error toggling auto-start ({}) ", autoStartResult), 6000l);
+	addOpenMetricsFamily(text, "ovrdr_resolution_changes", "counter", "Resolution changes since startup.");
+	fmt::format_to(out, "ovrdr_resolution_changes_total {}\n", snapshot.resolutionChanges);
 
-	// Minimize or hide the window according to config
-	if (minimizeOnStart == 1) // Minimize
-		glfwIconifyWindow(glfwWindow);
-	else if (minimizeOnStart == 2) // Hide
-		glfwHideWindow(glfwWindow);
+	addOpenMetricsFamily(text, "ovrdr_controller_ticks", "counter", "Resolution decisions since startup.");
+	fmt::format_to(out, "ovrdr_controller_ticks_total {}\n", snapshot.ticks);
 
-	// Make sure we can set resolution ourselves (Custom instead of Auto)
-	vr::VRSettings()->SetInt32(vr::k_pch_SteamVR_Section,
-							   vr::k_pch_SteamVR_SupersampleManualOverride_Bool, true);
+	addOpenMetricsFamily(text, "ovrdr_controller_tick_duration_seconds", "gauge", "Time the last resolution decision took, from reading the state to setting the resolution.");
+	fmt::format_to(out, "ovrdr_controller_tick_duration_seconds {}\n", snapshot.tickMs / 1000);
 
-	// Set default resolution
-	vr::VRSettings()->SetFloat(vr::k_pch_SteamVR_Section,
-							   vr::k_pch_SteamVR_SupersampleScale_Float, initialRes / 100.0f);
+	text += "# EOF\n";
+}
 
-#pragma region Initialise NVML
-	HMODULE nvmlLibrary;
-	nvmlDevice_t nvmlDevice;
-	float vramTotalGB;
+/// Renders the controller state as a control API state line
+void renderControlState(const ControllerSnapshot &snapshot, std::string &state)
+{
+	const ControllerDecision &decision = snapshot.decision;
+	state.clear();
+	fmt::format_to(std::back_inserter(state), "state app={} adjusting={} manual={} res={:.0f} width={} height={} hz={} fps={} target_fps={}-{} gpu_ms={:.2f} cpu_ms={:.2f} reprojection={:.2f} changes={}",
+				   snapshot.appKey[0] ? snapshot.appKey : "-", decision.adjustResolution ? 1 : 0, decision.manualRes ? 1 : 0, decision.newRes, snapshot.hmdWidthRes, snapshot.hmdHeightRes,
+				   decision.hmdHz, decision.currentFps, decision.targetFpsLow, decision.targetFpsHigh, decision.gpuTime, decision.cpuTime, std::max(decision.averageFrameShown - 1, 0.0f), snapshot.resolutionChanges);
+	if (snapshot.vramMonitored)
+		fmt::format_to(std::back_inserter(state), " vram_gb={:.2f}", decision.vramUsedGB);
+}
 
-	if (vramMonitorEnabled)
+/**
+ * Runs a control API command by sending it to the controller thread the same way the GUI does.
+ *   pause        manual resolution (like the "Manual resolution" button)
+ *   resume       dynamic resolution (like the "Dynamic resolution" button)
+ *   res <20-500> manual resolution at this value (like the manual resolution slider)
+ */
+void runControlCommand(ControllerChannels &channels, const std::string &command, std::string &response)
+{
+	if (command == "pause" || command == "resume")
 	{
-		nvmlInit_t nvmlInitPtr;
-#ifdef _WIN32
-		nvmlLibrary = LoadLibraryA("nvml.dll");
-		nvmlInitPtr = (nvmlInit_t)GetProcAddress(nvmlLibrary, "nvmlInit");
-#else
-		void *nvmlLibrary = dlopen("libnvidia-ml.so", RTLD_LAZY);
-		nvmlInitPtr = (nvmlInit_t)dlsym(nvmlLibrary, "nvmlInit");
-#endif
-		if (!nvmlInitPtr)
+		ControllerCommand manualRes;
+		manualRes.type = ControllerCommand_SetManualRes;
+		manualRes.manualRes = command == "pause";
+		response += channels.controlCommands.push(manualRes) ? "ok" : "error busy";
+	}
+	else if (command.compare(0, 4, "res ") == 0)
+	{
+		char *end;
+		float res = std::strtof(command.c_str() + 4, &end);
+		if (end == command.c_str() + 4 || *end != '\0' || res < 20 || res > 500)
 		{
-			nvmlEnabled = false;
+			response += "error resolution must be between 20 and 500";
+			return;
 		}
-		else
-		{
-			nvmlReturn_t result;
-			// Initialize NVML library
-			result = nvmlInitPtr();
-			if (result != NVML_SUCCESS)
-			{
-				nvmlEnabled = false;
-			}
-			else
-			{
-				// Get device handle
-				nvmlDeviceGetHandleByIndex_t nvmlDeviceGetHandleByIndexPtr;
-#ifdef _WIN32
-				nvmlDeviceGetHandleByIndexPtr = (nvmlDeviceGetHandleByIndex_t)GetProcAddress(nvmlLibrary, "nvmlDeviceGetHandleByIndex");
-#else
-				nvmlDeviceGetHandleByIndexPtr = (nvmlDeviceGetHandleByIndex_t)dlsym(nvmlLibrary, "nvmlDeviceGetHandleByIndex");
-#endif
-				if (!nvmlDeviceGetHandleByIndexPtr)
-					nvmlEnabled = false;
-				else
-					result = nvmlDeviceGetHandleByIndexPtr(gpuIndex, &nvmlDevice);
 
-				if (result != NVML_SUCCESS || !nvmlEnabled)
-				{
-					// Shutdown NVML
-					nvmlShutdown_t nvmlShutdownPtr;
-#ifdef _WIN32
-					nvmlShutdownPtr = (nvmlShutdown_t)GetProcAddress(nvmlLibrary, "nvmlShutdown");
-#else
-					nvmlShutdownPtr = (nvmlShutdown_t)dlsym(nvmlLibrary, "nvmlShutdown");
-#endif
-					if (nvmlShutdownPtr)
-						nvmlShutdownPtr();
-				}
-			}
-		}
+		ControllerCommand pinResolution;
+		pinResolution.type = ControllerCommand_PinResolution;
+		pinResolution.res = res;
+		response += channels.controlCommands.push(pinResolution) ? "ok" : "error busy";
 	}
 	else
 	{
-		nvmlEnabled = false;
+		response += "error unknown command";
 	}
-#pragma endregion
-#pragma region Tray
-#if defined(_WIN32)
-	const char *hideToggleText = "Hide";
-	if (minimizeOnStart == 2)
+}
+
+/// Settings of an application: the global settings with the overrides matching its key applied in order. Returns how many matched
+int resolveAppSettings(const ControllerSettings &globalSettings, const std::vector<AppOverride> &overrides, const std::string &appKey, ControllerSettings &appSettings)
+{
+	appSettings = globalSettings;
+	int matched = 0;
+	for (const AppOverride &appOverride : overrides)
 	{
-		hideToggleText = "Show";
+		if (appKey.empty() || !appKeyMatches(appOverride.pattern, appKey))
+			continue;
+		applyAppOverride(appOverride, settingSchema, appSettings);
+		matched++;
 	}
 
-	tray trayInstance = {
-		"icon.ico",
-		"OVR Dynamic Resolution",
-		[](tray *trayInstance)
-		{ trayInstance->menu->text = "Hide"; tray_update(trayInstance); glfwShowWindow(glfwWindow); },
-		new tray_menu_item[5]{
-			{hideToggleText, 0, 0, [](tray_menu_item *item)
-			 { if (item->text == "Hide") { item->text = "Show"; tray_update(tray_get_instance()); glfwHideWindow(glfwWindow); } 
-			   else { item->text = "Hide"; tray_update(tray_get_instance()); glfwShowWindow(glfwWindow); } }},
-			{"-", 0, 0, nullptr},
-			{"Quit", 0, 0, [](tray_menu_item *item)
-			 { trayQuit = true; }},
-			{nullptr, 0, 0, nullptr}}};
-
-	tray_init(&trayInstance);
-
-	std::thread trayThread([&]
-						   { while(tray_loop(1) == 0); trayQuit = true; });
-#endif // _WIN32
-#pragma endregion
+	// Each setting is only clamped to its own range, overrides (or settings.ini) can leave related ones out of order
+	appSettings.maxRes = std::max(appSettings.maxRes, appSettings.minRes);
+	appSettings.emergencyMaxCut = std::max(appSettings.emergencyMaxCut, appSettings.resDecreaseMin);
+	return matched;
+}
 
+/**
+ * Samples frames, adjusts resolution and handles OpenVR events on its own schedule,
+ * independently of the GUI, until told to quit or OpenVR quits.
+ */
+void controllerLoop(ControllerChannels &channels, const bool hasWindow)
+{
 	// Initialize loop variables
+	ControllerSettings controllerSettings;
+	std::vector<AppOverride> controllerAppOverrides;
+	channels.settings.read(controllerSettings);
+	channels.appOverrides.read(controllerAppOverrides);
 	Compositor_FrameTiming *frameTiming = new vr::Compositor_FrameTiming[openvrMaxFrames];
-	long lastChangeTime = getCurrentTimeMillis() - resChangeDelayMs - 1;
-	bool adjustResolution = true;
-	bool openvrQuit = false;
-	bool manualRes = false;
-
-	// Resolution variables to display in GUI
-	float averageGpuTime = 0;
-	int gpuFps = 0;
-	float averageCpuTime = 0;
-	int cpuFps = 0;
-	float averageFrameShown = 0;
-	float newRes = initialRes;
-	int targetFpsHigh = 0;
-	int targetFpsLow = 0;
-	float targetFrametimeHigh = 0;
-	float targetFrametimeLow = 0;
-	int hmdHz = 0;
-	float hmdFrametime = 0;
-	int currentFps = 0;
-	float vramUsedGB = 0;
-	uint32_t hmdWidthRes = 0;
-	uint32_t hmdHeightRes = 0;
-	int resIncreaseThresholdFps = 0;
-	int resDecreaseThresholdFps = 0;
+	FrameHistory frameHistory;
+	long lastSampleTime = 0;
+	long lastChangeTime = getCurrentTimeMillis() - controllerSettings.resChangeDelayMs - 1;
+	auto nextSampleTime = std::chrono::steady_clock::now();
+
+	ResolutionController controller(controllerSettings.initialRes);
+	AppProfiles appProfiles;
+	appProfiles.load(appProfilesPath);
+	FrameTraceWriter frameTrace;
+	bool traceEnabled = false;
+	bool gpuTelemetryEnabled = gpuTelemetry != nullptr;
+	bool servingMetrics = metricsServer != nullptr;
+	bool servingControl = controlServer != nullptr;
+	ControllerSnapshot snapshot;
+	snapshot.decision.newRes = controllerSettings.initialRes;
+	MetricPoint metricPoint;
+	long lastMetricTime = getCurrentTimeMillis();
+
+	// Current application, looked up again only when the scene process changes
+	AppKeys appKeys;
+	uint32_t appProcessId = 0;
+	int appId = noAppId;
+	bool appSupported = false;
+	AppProfile *appProfile = nullptr;
+	// Settings of the current application (what the controller uses)
+	ControllerSettings appSettings;
+	resolveAppSettings(controllerSettings, controllerAppOverrides, "", appSettings);
+
+	while (!channels.quit && !channels.openvrQuit)
+	{
+		// Get current time
+		long currentTime = getCurrentTimeMillis();
+		bool publish = false;
 
-	// GUI variables
-	bool showSettings = false;
-	bool prevAutoStart = autoStart;
+		// Settings edited in the GUI or settings.ini
+		bool settingsChanged = channels.settings.read(controllerSettings);
+		settingsChanged |= channels.appOverrides.read(controllerAppOverrides);
+		if (settingsChanged)
+		{
+			const std::string &appKey = appKeys.getKey(appId);
+			resolveAppSettings(controllerSettings, controllerAppOverrides, appKey, appSettings);
+			appSupported = isApplicationSupported(appSettings, appKey);
+		}
 
-	// event loop
-	while ((!glfwWindowShouldClose(glfwWindow) || closeToTray) && !openvrQuit && !trayQuit)
-	{
-		// Close to tray
-		if (glfwWindowShouldClose(glfwWindow) && closeToTray)
+		// Switch to the settings of a new application right away (the process is cached by the runtime)
+		uint32_t processId = vrRuntime->getSceneProcessId();
+		if (processId != appProcessId)
 		{
-			glfwSetWindowShouldClose(glfwWindow, false);
-			glfwHideWindow(glfwWindow);
-#if defined(_WIN32)
-			tray_get_instance()->menu->text = "Show";
-			tray_update(tray_get_instance());
-#endif
+			std::string appKey = vrRuntime->getSceneApplicationKey();
+			// Asked again next loop if the key isn't known yet
+			appProcessId = appKey.empty() ? 0 : processId;
+			int newAppId = appKeys.intern(appKey);
+			if (newAppId != appId)
+			{
+				// Save what was learned in the previous application
+				if (appProfiles.isDirty())
+					appProfiles.save(appProfilesPath);
+				appId = newAppId;
+				appProfile = appProfiles.find(appKey);
+				std::snprintf(snapshot.appKey, sizeof(snapshot.appKey), "%s", appKey.c_str());
+
+				int matched = resolveAppSettings(controllerSettings, controllerAppOverrides, appKey, appSettings);
+				appSupported = isApplicationSupported(appSettings, appKey);
+				if (matched > 0)
+					logLine(fmt::format("Applied {} [App:] section(s) of settings.ini to {}", matched, appKey));
+				publish = true;
+			}
 		}
 
-		// Get current time
-		long currentTime = getCurrentTimeMillis();
-
-		// Doesn't run every loop
-		if (currentTime - resChangeDelayMs > lastChangeTime)
+		// Actions from the GUI and the control API
+		ControllerCommand command;
+		while (channels.commands.pop(command) || channels.controlCommands.pop(command))
 		{
-			lastChangeTime = currentTime;
-
-#pragma region Getting data
-			float currentRes = vr::VRSettings()->GetFloat(vr::k_pch_SteamVR_Section, vr::k_pch_SteamVR_SupersampleScale_Float) * 100.0f;
-
-			// Check for external resolution change (if resolution got changed and it wasn't us)
-			if (externalResChangeCompatibility && std::fabs(newRes - currentRes) > 0.001f && !manualRes)
-				manualRes = true;
-
-			// Check for end of external resolution change (if automatic resolution is enabled)
-			if (externalResChangeCompatibility && !vr::VRSettings()->GetInt32(vr::k_pch_SteamVR_Section, vr::k_pch_SteamVR_SupersampleManualOverride_Bool))
+			switch (command.type)
 			{
-				vr::VRSettings()->SetInt32(vr::k_pch_SteamVR_Section, vr::k_pch_SteamVR_SupersampleManualOverride_Bool, true);
-				manualRes = false;
+			case ControllerCommand_SetManualRes:
+				controller.setManualRes(command.manualRes);
+				snapshot.decision.manualRes = command.manualRes;
+				snapshot.decision.adjustResolution = controller.shouldAdjustResolution(appSupported, vrRuntime->isDashboardVisible(), snapshot.decision.cpuTime, appSettings);
+				break;
+			case ControllerCommand_PinResolution:
+				controller.setManualRes(true);
+				snapshot.decision.manualRes = true;
+				snapshot.decision.adjustResolution = controller.shouldAdjustResolution(appSupported, vrRuntime->isDashboardVisible(), snapshot.decision.cpuTime, appSettings);
+				[[fallthrough]];
+			case ControllerCommand_SetResolution:
+				controller.setResolution(command.res);
+				frameHistory.clear();
+				snapshot.resolutionChanges++;
+				snapshot.decision.newRes = command.res;
+				vrRuntime->setSupersampleScale(command.res / 100.0f);
+				vrRuntime->getRecommendedRenderTargetSize(&snapshot.hmdWidthRes, &snapshot.hmdHeightRes);
+				break;
 			}
+			publish = true;
+		}
 
-			// Fetch resolution and target fps
-			newRes = currentRes;
-			float lastRes = newRes;
-			int displayFrequency = std::round(vr::VRSystem()->GetFloatTrackedDeviceProperty(0, Prop_DisplayFrequency_Float));
-			if (hmdHz != displayFrequency)
+		// Fetch the frames rendered since the last sample (with a small margin)
+		int framesToFetch = openvrMaxFrames;
+		if (snapshot.decision.hmdHz > 0)
+			framesToFetch = std::clamp((int)((currentTime - lastSampleTime) * snapshot.decision.hmdHz / 1000) + frameFetchMargin, 1, openvrMaxFrames);
+		lastSampleTime = currentTime;
+		frameTiming->m_nSize = sizeof(Compositor_FrameTiming);
+		uint32_t frameCount = vrRuntime->getFrameTimings(frameTiming, framesToFetch);
+		int newFrames = frameHistory.ingest(frameTiming, frameCount);
+		for (int i = frameHistory.size() - newFrames; i < frameHistory.size(); i++)
+		{
+			metricPoint.add(MetricSeries_GpuTime, frameHistory.at(i).gpuTime);
+			metricPoint.add(MetricSeries_CpuTime, frameHistory.at(i).cpuTime);
+		}
+
+		// Start or stop recording
+		if (appSettings.traceEnabled != traceEnabled)
+		{
+			traceEnabled = appSettings.traceEnabled;
+			if (traceEnabled)
 			{
-				hmdHz = displayFrequency;
-				hmdFrametime = 1000.0f / displayFrequency;
-				resIncreaseThresholdFps = std::round(1000.0f / ((resIncreaseThreshold / 100.0f) * hmdFrametime));
-				resDecreaseThresholdFps = std::round(1000.0f / ((resDecreaseThreshold / 100.0f) * hmdFrametime));
+				char tracePath[64];
+				std::tm now = toLocalTime(std::time(nullptr));
+				std::strftime(tracePath, sizeof(tracePath), "trace-%Y%m%d-%H%M%S.ovrt", &now);
+				if (frameTrace.open(tracePath, (size_t)appSettings.traceMaxMB * 1024 * 1024))
+					logLine(fmt::format("Recording frame trace to {}", tracePath));
+				else
+					logLine(fmt::format("Failed to create frame trace {}", tracePath));
 			}
-			targetFpsHigh = resIncreaseThresholdFps;
-			targetFpsLow = resDecreaseThresholdFps;
-			targetFrametimeHigh = 1000.0f / resIncreaseThresholdFps;
-			targetFrametimeLow = 1000.0f / resDecreaseThresholdFps;
-
-			// Define totals
-			float totalGpuTime = 0;
-			float totalCpuTime = 0;
-			int frameShownTotal = 0;
-
-			// Loop through past frames
-			frameTiming->m_nSize = sizeof(Compositor_FrameTiming);
-			vr::VRCompositor()->GetFrameTimings(frameTiming, openvrMaxFrames);
-			for (int i = 0; i < openvrMaxFrames; i++)
+			else if (frameTrace.isOpen())
 			{
-				// Get GPU frametime
-				float gpuTime = frameTiming[i].m_flTotalRenderGpuMs;
-
-				// Calculate CPU frametime
-				// https://github.com/Louka3000/OpenVR-Dynamic-Resolution/issues/18#issuecomment-1833105172
-				float cpuTime = frameTiming[i].m_flCompositorRenderCpuMs									 // Compositor
-								+ (frameTiming[i].m_flNewFrameReadyMs - frameTiming[i].m_flNewPosesReadyMs); // Application & Late Start
-
-				// How many times the current frame repeated (>1 = reprojecting)
-				int frameShown = std::max((int)frameTiming[i].m_nNumFramePresents, 1);
-				// Reason reprojection is happening
-				int reprojectionFlag = frameTiming[i].m_nReprojectionFlags;
-
-				// Add to totals
-				totalGpuTime += gpuTime;
-				totalCpuTime += std::max(cpuTime, .0f);
-				frameShownTotal += frameShown;
+				logLine(fmt::format("Recorded {} frames", frameTrace.getRecordCount()));
+				frameTrace.close();
 			}
+		}
 
-			// Calculate averages
-			averageGpuTime = totalGpuTime / openvrMaxFrames;
-			averageCpuTime = totalCpuTime / openvrMaxFrames;
-			averageFrameShown = (float)frameShownTotal / (float)openvrMaxFrames;
+		// Record the new frames (the last ones returned)
+		if (frameTrace.isOpen() && !frameTrace.isFull())
+		{
+			const ControllerDecision &decision = snapshot.decision;
+			uint8_t flags = (decision.adjustResolution ? FrameTraceFlag_AdjustResolution : 0) | (decision.manualRes ? FrameTraceFlag_ManualRes : 0) | (decision.waitingForFrames ? FrameTraceFlag_WaitingForFrames : 0) | (decision.gpuThrottled ? FrameTraceFlag_GpuThrottled : 0);
+			for (uint32_t i = frameCount - newFrames; i < frameCount; i++)
+				frameTrace.write(frameTiming[i], decision.newRes, decision.vramUsed, flags);
+			// Displayed with the next stats
+			snapshot.traceFrames = frameTrace.getRecordCount();
+		}
+
+		// Cut resolution right away when the new frames keep missing refreshes
+		float emergencyRes = controller.checkOverload(frameHistory, newFrames, appSettings);
+		if (emergencyRes > 0)
+		{
+			vrRuntime->setSupersampleScale(emergencyRes / 100.0f);
+			frameHistory.clear();
+			snapshot.decision.newRes = emergencyRes;
+			snapshot.resolutionChanges++;
+			vrRuntime->getRecommendedRenderTargetSize(&snapshot.hmdWidthRes, &snapshot.hmdHeightRes);
+			// The next tick waits for frames at the new resolution
+			lastChangeTime = currentTime;
+			publish = true;
+		}
 
-			// Debug override CPU and GPU
-			if (debugEnabled)
+		// Doesn't run every loop (sooner when frametimes are far from the targets)
+		if (currentTime - controller.getTickDelayMs(frameHistory, appSettings) > lastChangeTime)
+		{
+			// Frametime statistics of the frames about to be used
+			if (servingMetrics)
 			{
-				averageGpuTime = debugGpuFrametime;
-				averageCpuTime = debugCpuFrametime;
+				for (int i = 0; i < metricsEstimatorCount; i++)
+				{
+					snapshot.gpuTimes[i] = frameHistory.gpuTime(metricsEstimators[i]);
+					snapshot.cpuTimes[i] = frameHistory.cpuTime(metricsEstimators[i]);
+				}
 			}
+			auto tickStart = std::chrono::steady_clock::now();
+
+#pragma region Getting data
+			ControllerInput input;
+			input.elapsedMs = currentTime - lastChangeTime;
+			lastChangeTime = currentTime;
 
-			// GUI
-			gpuFps = std::round(1000.0f / averageGpuTime);
-			cpuFps = std::round(1000.0f / averageCpuTime);
+			input.currentRes = vrRuntime->getSupersampleScale() * 100.0f;
+			input.manualOverride = vrRuntime->getSupersampleManualOverride();
+			input.externalResChange = vrRuntime->pollExternalResolutionChange();
+			input.displayFrequency = vrRuntime->getDisplayFrequency();
+			vrRuntime->getRecommendedRenderTargetSize(&input.renderWidth, &input.renderHeight);
 
-			// Estimated current FPS
-			currentFps = hmdHz / averageFrameShown;
+			input.frames = &frameHistory;
 
-			// Reprojection logic
-			int reprojectEager = averageCpuTime > hmdFrametime;
-			int reprojectNormal = averageCpuTime / 2 > hmdFrametime;
-			int reprojectionCount = 0;
-			if (!ignoreCpuTime)
+			input.appId = appId;
+			input.appSupported = appSupported;
+			input.profileRes = appProfile ? appProfile->res : 0;
+			input.inDashboard = vrRuntime->isDashboardVisible();
+
+			// Get VRAM usage
+			GpuTelemetrySample gpuSample;
+			if (gpuTelemetryEnabled && !gpuTelemetry->read(gpuSample))
 			{
-				reprojectionCount = averageCpuTime / hmdFrametime; // floored
-				if (!preferReprojection)
-					reprojectionCount--;
+				gpuTelemetryEnabled = false;
+				logLine(fmt::format("Lost GPU telemetry ({}), VRAM monitoring disabled", gpuTelemetry->getName()));
 			}
-			// Scale with alwaysReproject and the const max
-			reprojectionCount = std::min(std::max(std::max(reprojectionCount, 0), alwaysReproject), maxReprojectionCount);
-			if (reprojectionCount > 0)
+			if (gpuTelemetryEnabled)
 			{
-				targetFpsHigh /= reprojectionCount + 1;
-				targetFpsLow /= reprojectionCount + 1;
-				targetFrametimeHigh *= reprojectionCount + 1;
-				targetFrametimeLow *= reprojectionCount + 1;
+				snapshot.vramTotalGB = gpuSample.vramTotalBytes / bitsToGB;
+				input.vramUsedGB = gpuSample.vramUsedBytes / bitsToGB;
+				input.vramUsed = (float)gpuSample.vramUsedBytes / (float)gpuSample.vramTotalBytes;
+				input.gpuUtilization = gpuSample.utilization;
+				input.gpuThrottled = gpuSample.throttled;
+				snapshot.gpuClockMHz = gpuSample.clockMHz;
+
+				// VRAM of the VR application alone, when the driver tells
+				uint64_t vramAppUsedBytes;
+				if (appProcessId && gpuTelemetry->readProcessVram(appProcessId, vramAppUsedBytes))
+					input.vramAppUsedGB = vramAppUsedBytes / bitsToGB;
 			}
+			input.vramTotalGB = snapshot.vramTotalGB;
+			snapshot.vramMonitored = gpuTelemetryEnabled;
+#pragma endregion
 
-			// Get VRAM usage
-			float vramUsed = 0; // Assume we always have free VRAM by default
-			if (nvmlEnabled)
+#pragma region Resolution adjustment
+			ControllerDecision &decision = snapshot.decision;
+			decision = controller.update(input, appSettings);
+
+			if (decision.settled && appSettings.appProfiles && appId != noAppId)
 			{
-				// Get memory info
-				nvmlDeviceGetMemoryInfo_t nvmlDeviceGetMemoryInfoPtr;
-#ifdef _WIN32
-				nvmlDeviceGetMemoryInfoPtr = (nvmlDeviceGetMemoryInfo_t)GetProcAddress(nvmlLibrary, "nvmlDeviceGetMemoryInfo");
-#else
-				nvmlDeviceGetMemoryInfoPtr = (nvmlDeviceGetMemoryInfo_t)dlsym(nvmlLibrary, "nvmlDeviceGetMemoryInfo");
-#endif
-				nvmlMemory_t nvmlMemory;
-				if (nvmlDeviceGetMemoryInfoPtr(nvmlDevice, &nvmlMemory) != NVML_SUCCESS)
-				{
-					nvmlEnabled = false;
-				}
+				if (appProfile)
+					appProfiles.update(*appProfile, decision.newRes, decision.gpuTime, decision.vramUsed);
 				else
 				{
-					vramTotalGB = nvmlMemory.total / bitsToGB;
-					vramUsedGB = nvmlMemory.used / bitsToGB;
-					vramUsed = (float)nvmlMemory.used / (float)nvmlMemory.total;
+					// The first time, which creates the profile
+					appProfiles.update(appKeys.getKey(appId), decision.newRes, decision.gpuTime, decision.vramUsed);
+					appProfile = appProfiles.find(appKeys.getKey(appId));
 				}
 			}
 
-			// Debug override for VRAM
-			if (debugEnabled)
+			if (decision.restoreManualOverride)
+				vrRuntime->setSupersampleManualOverride(true);
+
+			if (decision.setResolution)
 			{
-				vramUsedGB = vramTotalGB * debugVramUsage;
-				vramUsed = debugVramUsage;
+				// Sets the new resolution
+				vrRuntime->setSupersampleScale(decision.newRes / 100.0f);
+
+				// Frames rendered at the previous resolution don't matter anymore
+				frameHistory.clear();
+				snapshot.resolutionChanges++;
 			}
+
+			vrRuntime->getRecommendedRenderTargetSize(&snapshot.hmdWidthRes, &snapshot.hmdHeightRes);
+			snapshot.ticks++;
+			snapshot.tickMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - tickStart).count();
+
+			// New stats to display
+			publish = true;
+		}
 #pragma endregion
 
-#pragma region Resolution adjustment
-			// Get the current application key
-			std::string appKey = getCurrentApplicationKey();
-			adjustResolution = shouldAdjustResolution(appKey, manualRes, averageCpuTime);
-			if (adjustResolution)
-			{
-				// Adjust resolution
-				if ((averageCpuTime > minCpuTimeThreshold || vramOnlyMode))
-				{
-					// Frametime
-					if (averageGpuTime < targetFrametimeHigh && vramUsed < vramTarget / 100.0f && !vramOnlyMode)
-					{
-						// Increase resolution
-						newRes += ((targetFrametimeHigh - averageGpuTime) * (resIncreaseScale / 100.0f)) + resIncreaseMin;
-					}
-					else if (averageGpuTime > targetFrametimeLow && !vramOnlyMode)
-					{
-						// Decrease resolution
-						newRes -= ((averageGpuTime - targetFrametimeLow) * (resDecreaseScale / 100.0f)) + resDecreaseMin;
-					}
+		// Graph the state at each sample, sent every metric history interval
+		if (snapshot.decision.hmdHz > 0)
+		{
+			metricPoint.add(MetricSeries_TargetLow, snapshot.decision.targetFrametimeLow);
+			metricPoint.add(MetricSeries_TargetHigh, snapshot.decision.targetFrametimeHigh);
+		}
+		metricPoint.add(MetricSeries_Resolution, snapshot.decision.newRes);
+		if (snapshot.vramMonitored)
+			metricPoint.add(MetricSeries_VramUsedGB, snapshot.decision.vramUsedGB);
+		if (currentTime - lastMetricTime >= metricHistoryIntervalMs)
+		{
+			// Dropped if the GUI doesn't keep up (or there's no GUI)
+			if (hasWindow)
+				channels.metrics.push(metricPoint);
+			metricPoint.clear();
+			// Catch up after a stall without sending a burst of points
+			lastMetricTime = std::max(lastMetricTime + metricHistoryIntervalMs, currentTime - metricHistoryIntervalMs);
+		}
 
-					// VRAM
-					if (vramUsed > vramLimit / 100.0f)
-					{
-						// Force the resolution to decrease when the vram limit is reached
-						newRes -= resDecreaseMin;
-					}
-					else if (vramOnlyMode && newRes < initialRes && vramUsed < vramTarget / 100.0f)
-					{
-						// When in VRAM-only mode, make sure the res goes back up when possible.
-						newRes = std::min(initialRes, (int)std::round(newRes) + resIncreaseMin);
-					}
+		// Check if OpenVR is quitting so we can quit alongside it
+		if (vrRuntime->pollQuit())
+			channels.openvrQuit = true;
 
-					// Clamp the new resolution
-					newRes = std::clamp((int)std::round(newRes), minRes, maxRes);
-				}
-			}
-			else if ((appKey == "" || (resetOnThreshold && averageCpuTime < minCpuTimeThreshold)) && !manualRes)
-			{
-				// If (in SteamVR void or cpuTime below threshold) and user didn't pause res
-				// Reset to initialRes
-				newRes = initialRes;
-			}
+		if (publish)
+		{
+			snapshot.vramOnlyMode = appSettings.vramOnlyMode;
+			snapshot.vramTarget = appSettings.vramTarget;
+			snapshot.vramLimit = appSettings.vramLimit;
+			snapshot.frametimeEstimator = appSettings.frametimeEstimator;
+			snapshot.controllerMode = appSettings.controllerMode;
+			snapshot.maxRes = appSettings.maxRes;
+			channels.snapshots.write(snapshot);
+			if (servingMetrics)
+				channels.metricsSnapshots.write(snapshot);
+			if (servingControl)
+				channels.controlSnapshots.write(snapshot);
+			// Wake the GUI up to display it
+			if (hasWindow)
+				glfwPostEmptyEvent();
+		}
 
-			if (newRes != lastRes)
-			{
-				// Sets the new resolution
-				vr::VRSettings()->SetFloat(vr::k_pch_SteamVR_Section, vr::k_pch_SteamVR_SupersampleScale_Float, newRes / 100.0f);
-			}
+		// Keep a steady sample rate regardless of how long this loop took
+		nextSampleTime = std::max(nextSampleTime + controllerSampleInterval, std::chrono::steady_clock::now());
+		std::this_thread::sleep_until(nextSampleTime);
+	}
+
+	if (appProfiles.isDirty())
+		appProfiles.save(appProfilesPath);
+	frameTrace.close();
+
+	delete[] frameTiming;
+}
+#pragma endregion
+
+std::string executable_path;
+
+std::string get_executable_path()
+{
+	return executable_path;
+}
+
+int main(int argc, char *argv[])
+{
+	executable_path = argc > 0 ? std::filesystem::absolute(std::filesystem::path(argv[0])).string() : "";
+
+	// Load settings from ini file
+	resetSettings(settingSchema, settingCount);
+	if (!loadSettings())
+		saveSettings(); // Restore settings
+
+	runHeadless = headless;
+	std::string fakeVrScenario;
+	for (int i = 1; i < argc; i++)
+	{
+		// Run without a window (and without a graphics context)
+		if (std::string(argv[i]) == "--headless")
+			runHeadless = true;
+		// Run against a scripted fake VR runtime instead of SteamVR
+		else if (std::string(argv[i]) == "--fake-vr" && i + 1 < argc)
+			fakeVrScenario = argv[++i];
+	}
+
+#pragma region GUI init
+	if (!runHeadless)
+	{
+		if (!glfwInit())
+			return 1;
+
+		// GL 3.0 + GLSL 130
+		const char *glsl_version = "#version 130";
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+
+		// Make window non-resizable
+		glfwWindowHint(GLFW_RESIZABLE, false);
+
+		// Create window with graphics context
+		glfwWindow = glfwCreateWindow(mainWindowWidth, mainWindowHeight, "OVR Dynamic Resolution", nullptr, nullptr);
+		if (glfwWindow == nullptr)
+			return 1;
+		glfwMakeContextCurrent(glfwWindow);
+
+		// Setup Dear ImGui context
+		IMGUI_CHECKVERSION();
+		ImGui::CreateContext();
+		ImGuiIO &io = ImGui::GetIO();
 
-			vr::VRSystem()->GetRecommendedRenderTargetSize(&hmdWidthRes, &hmdHeightRes);
+		// Don't save Dear ImGui window state
+		io.IniFilename = NULL;
+
+		// Setup Dear ImGui style
+		ImGui::StyleColorsDark();
+		ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(0.03, 0.03, 0.03, 1));
+
+		// Redraw the GUI on input (set before the ImGui backend, which chains them)
+		glfwSetCursorPosCallback(glfwWindow, [](GLFWwindow *, double, double)
+								 { markGuiInput(); });
+		glfwSetCursorEnterCallback(glfwWindow, [](GLFWwindow *, int)
+								   { markGuiInput(); });
+		glfwSetMouseButtonCallback(glfwWindow, [](GLFWwindow *, int, int, int)
+								   { markGuiInput(); });
+		glfwSetScrollCallback(glfwWindow, [](GLFWwindow *, double, double)
+							  { markGuiInput(); });
+		glfwSetKeyCallback(glfwWindow, [](GLFWwindow *, int, int, int, int)
+						   { markGuiInput(); });
+		glfwSetCharCallback(glfwWindow, [](GLFWwindow *, unsigned int)
+							{ markGuiInput(); });
+		glfwSetWindowFocusCallback(glfwWindow, [](GLFWwindow *, int)
+								   { markGuiInput(); });
+		glfwSetWindowIconifyCallback(glfwWindow, [](GLFWwindow *, int)
+									 { markGuiInput(); });
+		glfwSetWindowRefreshCallback(glfwWindow, [](GLFWwindow *)
+									 { markGuiInput(); });
+
+		// Setup Platform/Renderer backends
+		ImGui_ImplGlfw_InitForOpenGL(glfwWindow, true);
+#ifdef __EMSCRIPTEN__
+		ImGui_ImplGlfw_InstallEmscriptenCallbacks(window, "#canvas");
+#endif
+		ImGui_ImplOpenGL3_Init(glsl_version);
+
+		// Set window icon
+		GLFWimage icon;
+		unsigned iconWidth, iconHeight;
+		if (lodepng_decode32_file(&(icon.pixels), &(iconWidth), &(iconHeight), iconPath) == 0)
+		{
+			icon.width = (int)iconWidth;
+			icon.height = (int)iconHeight;
+			glfwSetWindowIcon(glfwWindow, 1, &icon);
 		}
+	}
 #pragma endregion
 
-#pragma region Gui rendering
-		glfwPollEvents();
+#pragma region VR init
+	if (fakeVrScenario.empty())
+		vrRuntime = createOpenVrRuntime();
+	else
+		vrRuntime = createFakeVrRuntime(fakeVrScenario);
+	std::string vrInitError = vrRuntime->init();
+	if (!vrInitError.empty())
+	{
+		printLine(vrInitError, 6000l);
+		return EXIT_FAILURE;
+	}
+#pragma endregion
 
-		// Start the Dear ImGui frame
-		ImGui_ImplOpenGL3_NewFrame();
-		ImGui_ImplGlfw_NewFrame();
-		ImGui::NewFrame();
+	// Set auto-start
+	int autoStartResult = vrRuntime->setAutoStart(autoStart);
+	if (autoStartResult != 0)
+		printLine(fmt::format("Error toggling auto-start ({}) ", autoStartResult), 6000l);
+
+	// Minimize or hide the window according to config
+	if (runHeadless)
+		logLine(fmt::format("OVR Dynamic Resolution {} started in headless mode", version));
+	else if (minimizeOnStart == 1) // Minimize
+		glfwIconifyWindow(glfwWindow);
+	else if (minimizeOnStart == 2) // Hide
+		glfwHideWindow(glfwWindow);
 
-		// Make sure buttons are gray
-		pushGrayButtonColour();
+	// Make sure we can set resolution ourselves (Custom instead of Auto)
+	vrRuntime->setSupersampleManualOverride(true);
 
-#pragma region Main window
-		if (!showSettings)
+	// Set default resolution
+	vrRuntime->setSupersampleScale(settings.initialRes / 100.0f);
+
+#pragma region Initialise GPU telemetry
+	if (vramMonitorEnabled)
+	{
+		if (fakeVrScenario.empty())
+			gpuTelemetry = createGpuTelemetry(gpuIndex);
+		else
+			gpuTelemetry = createFakeGpuTelemetry(*vrRuntime);
+
+		if (gpuTelemetry)
+			logLine(fmt::format("Monitoring VRAM with {}", gpuTelemetry->getName()));
+		else
+			logLine(fmt::format("No supported GPU at index {}, VRAM monitoring disabled", gpuIndex));
+	}
+#pragma endregion
+#pragma region Tray
+#if defined(_WIN32)
+	const char *hideToggleText = "Hide";
+	if (minimizeOnStart == 2)
+	{
+		hideToggleText = "Show";
+	}
+
+	tray trayInstance = {
+		"icon.ico",
+		"OVR Dynamic Resolution",
+		[](tray *trayInstance)
+		{ trayInstance->menu->text = "Hide"; tray_update(trayInstance); glfwShowWindow(glfwWindow); },
+		new tray_menu_item[5]{
+			{hideToggleText, 0, 0, [](tray_menu_item *item)
+			 { if (item->text == "Hide") { item->text = "Show"; tray_update(tray_get_instance()); glfwHideWindow(glfwWindow); } 
+			   else { item->text = "Hide"; tray_update(tray_get_instance()); glfwShowWindow(glfwWindow); } }},
+			{"-", 0, 0, nullptr},
+			{"Quit", 0, 0, [](tray_menu_item *item)
+			 { trayQuit = true; }},
+			{nullptr, 0, 0, nullptr}}};
+
+	// No window to show or hide in headless mode
+	std::thread trayThread;
+	if (!runHeadless)
+	{
+		tray_init(&trayInstance);
+
+		trayThread = std::thread([&]
+								 { while(tray_loop(1) == 0); trayQuit = true; });
+	}
+#endif // _WIN32
+#pragma endregion
+
+	// Start adjusting resolution
+	ControllerChannels channels;
+	channels.settings.write(settings);
+	channels.appOverrides.write(appOverrides);
+
+	// Serve metrics from their own thread
+	if (metricsEnabled)
+	{
+		// Renders the latest state published by the controller thread, on the server's thread
+		auto renderMetrics = [&channels](std::string &text)
 		{
-			// Create the main window
-			ImGui::Begin("Main", NULL, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoScrollbar);
+			ControllerSnapshot snapshot;
+			if (!channels.metricsSnapshots.read(snapshot))
+				return false;
+			renderOpenMetrics(snapshot, text);
+			return true;
+		};
+		metricsServer = std::make_unique<MetricsServer>();
+		bool started = metricsServer->start(metricsPort, renderMetrics);
+		if (started)
+			logLine(fmt::format("Serving metrics on http://127.0.0.1:{}/metrics", metricsPort));
+		else
+		{
+			logLine(fmt::format("Couldn't serve metrics on port {}", metricsPort));
+			metricsServer.reset();
+		}
+	}
+
+	// Serve the control API from its own thread
+	if (controlEnabled)
+	{
+		auto runCommand = [&channels](const std::string &command, std::string &response)
+		{
+			runControlCommand(channels, command, response);
+		};
+		auto renderState = [&channels](std::string &state)
+		{
+			ControllerSnapshot snapshot;
+			if (!channels.controlSnapshots.read(snapshot))
+				return false;
+			renderControlState(snapshot, state);
+			return true;
+		};
+		controlServer = std::make_unique<ControlServer>();
+		if (controlServer->start(controlSocketPath, runCommand, renderState))
+			logLine(fmt::format("Control API listening on {}", controlSocketPath));
+		else
+		{
+			logLine(fmt::format("Couldn't create the control API socket {}", controlSocketPath));
+			controlServer.reset();
+		}
+	}
+
+	// Apply edits to settings.ini without restarting
+	settingsWatcher = std::make_unique<SettingsWatcher>();
+	if (!settingsWatcher->start(settingsPath))
+	{
+		logLine(fmt::format("Couldn't watch {} for changes", settingsPath));
+		settingsWatcher.reset();
+	}
+	std::thread controllerThread(controllerLoop, std::ref(channels), !runHeadless);
+
+	// Latest state from the controller thread (displayed in GUI)
+	ControllerSnapshot state;
+	state.decision.newRes = settings.initialRes;
+	state.vramOnlyMode = settings.vramOnlyMode;
+	state.vramTarget = settings.vramTarget;
+	state.vramLimit = settings.vramLimit;
+	state.frametimeEstimator = settings.frametimeEstimator;
+	state.controllerMode = settings.controllerMode;
+	state.maxRes = settings.maxRes;
 
-			// Set position and size to fill the viewport
-			ImGui::SetWindowPos(ImVec2(0, 0));
-			ImGui::SetWindowSize(ImVec2(mainWindowWidth, mainWindowHeight));
+	// GUI variables
+	bool showSettings = false;
+	bool showGraphs = false;
+	bool prevAutoStart = autoStart;
+	bool guiDirty = true;
+	long lastRenderTime = 0;
 
-			// Title
-			ImGui::Text(fmt::format("OVR Dynamic Resolution {}", version).c_str());
+	// Applies the settings edited in settings.ini, all at once
+	auto applySettingsFile = [&]()
+	{
+		if (!settingsWatcher || !settingsWatcher->poll())
+			return;
 
-			ImGui::Separator();
+		bool changed[settingCount] = {};
+		bool overridesChanged;
+		int changedCount = reloadSettings(changed, overridesChanged);
+		if (changedCount == 0 && !overridesChanged)
+			return;
 
-			if (debugEnabled)
-			{
-				ImGui::TextWrapped("Debug enabled");
-				ImGui::Separator();
-			}
-			else
-			{
-				ImGui::NewLine();
-			}
+		std::string changedKeys;
+		for (int i = 0; i < settingCount; i++)
+		{
+			if (changed[i])
+				changedKeys += fmt::format("{}{}", changedKeys.empty() ? "" : ", ", settingSchema[i].key);
+		}
+		if (overridesChanged)
+			changedKeys += fmt::format("{}[App:] sections", changedKeys.empty() ? "" : ", ");
+		logLine(fmt::format("Reloaded {}: {}", settingsPath, changedKeys));
 
-			// HMD Hz
-			ImGui::Text("%s", fmt::format("HMD refresh rate: {} hz ({:.2f} ms)", hmdHz, hmdFrametime).c_str());
+		if (changed[settingIndex("autoStart")])
+		{
+			vrRuntime->setAutoStart(autoStart);
+			prevAutoStart = autoStart;
+		}
+		// Unchanged settings keep their values, so the controller carries on where it was
+		channels.settings.write(settings);
+		if (overridesChanged)
+			channels.appOverrides.write(appOverrides);
+		guiDirty = true;
+	};
 
-			// Target FPS and frametime
-			if (!vramOnlyMode)
-			{
-				ImGui::Text("%s", fmt::format("Target FPS: {}-{} fps ({:.2f}-{:.2f} ms)", targetFpsLow, targetFpsHigh, targetFrametimeLow, targetFrametimeHigh).c_str());
-			}
-			else
-			{
-				ImGui::Text("Target FPS: Disabled");
-			}
+	// event loop
+	while ((runHeadless || !glfwWindowShouldClose(glfwWindow) || closeToTray) && !channels.openvrQuit && !trayQuit)
+	{
+		// Nothing to do but apply settings.ini edits and wait for the controller thread to quit
+		if (runHeadless)
+		{
+			applySettingsFile();
+			std::this_thread::sleep_for(refreshIntervalBackground);
+			continue;
+		}
 
-			// VRAM target and limit
-			if (nvmlEnabled && nvmlEnabled)
-			{
-				ImGui::Text("%s", fmt::format("VRAM target: {:.2f} GB", vramTarget / 100.0f * vramTotalGB).c_str());
-				ImGui::Text("%s", fmt::format("VRAM limit: {:.2f} GB ", vramLimit / 100.0f * vramTotalGB).c_str());
-			}
-			else
-			{
-				ImGui::Text("VRAM target: Disabled");
-				ImGui::Text("VRAM limit: Disabled");
-			}
+		// Close to tray
+		if (glfwWindowShouldClose(glfwWindow) && closeToTray)
+		{
+			glfwSetWindowShouldClose(glfwWindow, false);
+			glfwHideWindow(glfwWindow);
+#if defined(_WIN32)
+			tray_get_instance()->menu->text = "Show";
+			tray_update(tray_get_instance());
+#endif
+		}
 
-			ImGui::NewLine();
+		// Get current time
+		long currentTime = getCurrentTimeMillis();
 
-			// FPS and frametimes
-			ImGui::Text("%s", fmt::format("Displayed FPS: {} fps", currentFps).c_str());
-			ImGui::Text("%s", fmt::format("GPU frametime: {:.2f} ms ({} fps)", averageGpuTime, gpuFps).c_str());
-			ImGui::Text("%s", fmt::format("CPU frametime: {:.2f} ms ({} fps)", averageCpuTime, cpuFps).c_str());
+		applySettingsFile();
 
-			// VRAM usage
-			if (nvmlEnabled)
-				ImGui::Text("%s", fmt::format("VRAM usage: {:.2f} GB", vramUsedGB).c_str());
-			else
-				ImGui::Text("%s", fmt::format("VRAM usage: Disabled").c_str());
+		// New stats to display
+		if (channels.snapshots.read(state))
+			guiDirty = true;
+		MetricPoint metricPoint;
+		while (channels.metrics.pop(metricPoint))
+		{
+			metricHistory.add(metricPoint);
+			guiDirty |= showGraphs;
+		}
 
-			ImGui::NewLine();
+#pragma region Gui rendering
+		// Whether settings were edited (or reverted) in the settings window
+		bool settingsEdited = false;
+		// Only redraw when there's something new to show and the window can be seen
+		bool guiVisible = glfwGetWindowAttrib(glfwWindow, GLFW_VISIBLE) && !glfwGetWindowAttrib(glfwWindow, GLFW_ICONIFIED);
+		bool guiActive = guiVisible && (currentTime - lastGuiInputTime < guiInputRedrawMs || ImGui::GetIO().WantTextInput);
+		if (guiVisible && (guiDirty || guiActive) && currentTime - lastRenderTime >= refreshIntervalFocused.count())
+		{
+			guiDirty = false;
+			lastRenderTime = currentTime;
 
-			// Reprojection ratio
-			ImGui::Text("%s", fmt::format("Reprojection ratio: {:.2f}", averageFrameShown - 1).c_str());
+			// Start the Dear ImGui frame
+			ImGui_ImplOpenGL3_NewFrame();
+			ImGui_ImplGlfw_NewFrame();
+			ImGui::NewFrame();
 
-			// Current resolution
-			if (manualRes)
-			{
-				ImGui::Text("Resolution =");
-			}
-			else
-			{
-				ImGui::Text("%s", fmt::format("Resolution = {:.0f} ({} x {})", newRes, hmdWidthRes, hmdHeightRes).c_str());
-			}
+			// Make sure buttons are gray
+			pushGrayButtonColour();
 
-			// Resolution adjustment status
-			if (!adjustResolution)
+#pragma region Main window
+			if (!showSettings && !showGraphs)
 			{
-				ImGui::SameLine(0, 10);
-				if (manualRes)
+				// Create the main window
+				ImGui::Begin("Main", NULL, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoScrollbar);
+
+				// Set position and size to fill the viewport
+				ImGui::SetWindowPos(ImVec2(0, 0));
+				ImGui::SetWindowSize(ImVec2(mainWindowWidth, mainWindowHeight));
+
+				// Title
+				ImGui::Text(fmt::format("OVR Dynamic Resolution {}", version).c_str());
+
+				ImGui::Separator();
+
+				if (settings.debugEnabled)
 				{
-					ImGui::PushItemWidth(192);
-					ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(0, 0));
-					if (ImGui::SliderFloat("##", &newRes, 20.0f, 500.0f, fmt::format("%.0f ({} x {})", hmdWidthRes, hmdHeightRes).c_str(), ImGuiSliderFlags_AlwaysClamp))
-					{
-						vr::VRSettings()->SetFloat(vr::k_pch_SteamVR_Section, vr::k_pch_SteamVR_SupersampleScale_Float, newRes / 100.0f);
-						vr::VRSystem()->GetRecommendedRenderTargetSize(&hmdWidthRes, &hmdHeightRes);
-					}
-					ImGui::PopStyleVar();
+					ImGui::TextWrapped("Debug enabled");
+					ImGui::Separator();
 				}
 				else
 				{
-					ImGui::Text("(paused)");
+					ImGui::NewLine();
 				}
-			}
-
-			ImGui::NewLine();
-
-			// Open settings
-			bool settingsPressed = ImGui::Button("Settings", ImVec2(82, 28));
-			if (settingsPressed)
-				showSettings = true;
-
-			// Resolution pausing
-			ImGui::SameLine();
-			const char *pauseText;
-			if (!manualRes)
-				pauseText = "Manual resolution";
-			else
-				pauseText = "Dynamic resolution";
-			bool pausePressed = ImGui::Button(pauseText, ImVec2(142, 28));
-			if (pausePressed)
-			{
-				manualRes = !manualRes;
-				adjustResolution = shouldAdjustResolution(getCurrentApplicationKey(), manualRes, averageCpuTime);
-			}
-
-			// Stop creating the main window
-			ImGui::End();
-		}
-#pragma endregion
-
-#pragma region Settings window
-		if (showSettings)
-		{
-			// Create the settings window
-			ImGui::Begin("Settings", NULL, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove);
 
-			// Set position and size to fill the viewport
-			ImGui::SetWindowPos(ImVec2(0, 0));
-			ImGui::SetWindowSize(ImVec2(mainWindowWidth, mainWindowHeight));
+				// HMD Hz
+				ImGui::Text("%s", fmt::format("HMD refresh rate: {} hz ({:.2f} ms)", state.decision.hmdHz, state.decision.hmdFrametime).c_str());
 
-			// Set the labels' width
-			ImGui::PushItemWidth(96);
+				// Target FPS and frametime
+				if (!state.vramOnlyMode)
+				{
+					ImGui::Text("%s", fmt::format("Target FPS: {}-{} fps ({:.2f}-{:.2f} ms)", state.decision.targetFpsLow, state.decision.targetFpsHigh, state.decision.targetFrametimeLow, state.decision.targetFrametimeHigh).c_str());
+				}
+				else
+				{
+					ImGui::Text("Target FPS: Disabled");
+				}
 
-			// Title
-			ImGui::Text("Settings");
+				// VRAM target and limit
+				if (state.vramMonitored)
+				{
+					ImGui::Text("%s", fmt::format("VRAM target: {:.2f} GB", state.vramTarget / 100.0f * state.vramTotalGB).c_str());
+					ImGui::Text("%s", fmt::format("VRAM limit: {:.2f} GB ", state.vramLimit / 100.0f * state.vramTotalGB).c_str());
+				}
+				else
+				{
+					ImGui::Text("VRAM target: Disabled");
+					ImGui::Text("VRAM limit: Disabled");
+				}
 
-			ImGui::Separator();
-			ImGui::NewLine();
+				ImGui::NewLine();
 
-			// GUI settings inputs
-			if (ImGui::CollapsingHeader("Startup"))
-			{
-				ImGui::Checkbox("Start with SteamVR", &autoStart);
-				addTooltip("Automatically launch OVRDR alongside SteamVR.");
-
-				ImGui::Text("Window startup behaviour:");
-				ImGui::RadioButton("Visible", &minimizeOnStart, 0);
-				addTooltip("Keep the OVRDR window visible on startup.");
-				ImGui::RadioButton("Minimized (taskbar)", &minimizeOnStart, 1);
-				addTooltip("Minimize the OVRDR window to the taskbar on startup.");
-				ImGui::RadioButton("Hidden (tray)", &minimizeOnStart, 2);
-				addTooltip("Hide the OVRDR window completely on startup. You can still show the window by clicking \"Show\" in the tray icon's context menu.");
-			}
+				// FPS and frametimes
+				ImGui::Text("%s", fmt::format("Displayed FPS: {} fps", state.decision.currentFps).c_str());
+				if (state.frametimeEstimator == FrametimeEstimator_Mean)
+				{
+					ImGui::Text("%s", fmt::format("GPU frametime: {:.2f} ms ({} fps)", state.decision.gpuTime, state.decision.gpuFps).c_str());
+					ImGui::Text("%s", fmt::format("CPU frametime: {:.2f} ms ({} fps)", state.decision.cpuTime, state.decision.cpuFps).c_str());
+				}
+				else
+				{
+					const char *estimatorName = frametimeEstimatorNames[state.frametimeEstimator];
+					ImGui::Text("%s", fmt::format("GPU frametime ({}): {:.2f} ms ({} fps)", estimatorName, state.decision.gpuTime, state.decision.gpuFps).c_str());
+					ImGui::Text("%s", fmt::format("CPU frametime ({}): {:.2f} ms ({} fps)", estimatorName, state.decision.cpuTime, state.decision.cpuFps).c_str());
+				}
 
-			if (ImGui::CollapsingHeader("General"))
-			{
-				ImGui::Checkbox("Close to tray", &closeToTray);
-				addTooltip("Minimize the window to the tray when closing it instead of closing the application.");
-
-				ImGui::Checkbox("External res change compatibility", &externalResChangeCompatibility);
-				addTooltip("Automatically switch to manual resolution adjustment within the app when VR resolution is changed from an external source (SteamVR setting, Oyasumi, etc.) as to let the external source control the resolution. Automatically switches back to dynamic resolution adjustment when resolution is set to automatic.");
-
-				ImGui::Text("Blacklist");
-				addTooltip("Don't allow resolution changes in blacklisted applications.");
-				if (ImGui::InputTextMultiline("Blacklisted apps", &blacklistApps, ImVec2(130, 60), ImGuiInputTextFlags_CharsNoBlank))
-					blacklistAppsSet = multilineStringToSet(blacklistApps);
-				addTooltip("List of OpenVR application keys that should be blacklisted for resolution adjustment in the format \'steam.app.APPID\' (e.g. \'steam.app.620980\' for Beat Saber). One per line.");
-				if (ImGui::Button("Blacklist current app", ImVec2(160, 26)))
+				// VRAM usage
+				if (state.vramMonitored)
 				{
-					std::string appKey = getCurrentApplicationKey();
-					if (!isApplicationBlacklisted(appKey))
+					ImGui::Text("%s", fmt::format("VRAM usage: {:.2f} GB", state.decision.vramUsedGB).c_str());
+					if (state.decision.vramAppUsedGB > 0)
 					{
-						blacklistAppsSet.insert(appKey);
-						if (blacklistApps != "")
-							blacklistApps += "\n";
-						blacklistApps += appKey;
+						ImGui::SameLine();
+						ImGui::TextDisabled("%s", fmt::format("(app: {:.2f} GB)", state.decision.vramAppUsedGB).c_str());
 					}
 				}
-				addTooltip("Adds the current application to the blacklist.");
-
-				ImGui::Checkbox("Enable whitelist", &whitelistEnabled);
-				addTooltip("Only allow resolution changes in whitelisted applications.");
-				if (ImGui::InputTextMultiline("Whitelisted apps", &whitelistApps, ImVec2(130, 60), ImGuiInputTextFlags_CharsNoBlank))
-					whitelistAppsSet = multilineStringToSet(whitelistApps);
-				addTooltip("List of OpenVR application keys that should be whitelisted for resolution adjustment in the format \'steam.app.APPID\' (e.g. \'steam.app.620980\' for Beat Saber). One per line.");
-				if (ImGui::Button("Whitelist current app", ImVec2(164, 26)))
+				else
+					ImGui::Text("%s", fmt::format("VRAM usage: Disabled").c_str());
+
+				// GPU state
+				if (state.vramMonitored && state.decision.gpuUtilization >= 0)
 				{
-					std::string appKey = getCurrentApplicationKey();
-					if (!isApplicationWhitelisted(appKey))
+					std::string clock = state.gpuClockMHz > 0 ? fmt::format(", {} MHz", state.gpuClockMHz) : "";
+					ImGui::Text("%s", fmt::format("GPU load: {}%{}{}", state.decision.gpuUtilization, clock, state.decision.gpuThrottled ? " (throttled)" : "").c_str());
+					if (state.decision.gpuLimited)
 					{
-						whitelistAppsSet.insert(appKey);
-						if (whitelistApps != "")
-							whitelistApps += "\n";
-						whitelistApps += appKey;
+						ImGui::SameLine();
+						ImGui::TextDisabled("(holding)");
 					}
 				}
-				addTooltip("Adds the current application to the whitelist.");
-			}
 
-			if (ImGui::CollapsingHeader("Resolution"))
-			{
-				if (ImGui::InputInt("Resolution change delay ms", &resChangeDelayMs, 100))
-					resChangeDelayMs = std::max(resChangeDelayMs, 100);
-				addTooltip("Delay in milliseconds between resolution changes.");
+				ImGui::NewLine();
 
-				if (ImGui::InputInt("Initial resolution", &initialRes, 5))
-					initialRes = std::clamp(initialRes, 20, 500);
-				addTooltip("The resolution set at startup. Also used when resetting resolution.");
+				// Reprojection ratio
+				ImGui::Text("%s", fmt::format("Reprojection ratio: {:.2f}", state.decision.averageFrameShown - 1).c_str());
 
-				if (ImGui::InputInt("Minimum resolution", &minRes, 5))
-					minRes = std::clamp(minRes, 20, 500);
-				addTooltip("The minimum resolution OVRDR will set.");
+				// What limits the framerate
+				ImGui::Text("%s", fmt::format("Bottleneck: {}", bottleneckNames[state.decision.bottleneck]).c_str());
 
-				if (ImGui::InputInt("Maximum resolution", &maxRes, 5))
-					maxRes = std::clamp(maxRes, 20, 500);
-				addTooltip("The maximum resolution OVRDR will set.");
+				// Frametime model
+				if (state.controllerMode == ControllerMode_Model && state.decision.modelMsPerMegapixel > 0)
+					ImGui::Text("%s", fmt::format("GPU model: {:.2f} ms + {:.2f} ms/MP", state.decision.modelFixedTime, state.decision.modelMsPerMegapixel).c_str());
 
-				if (ImGui::TreeNodeEx("Advanced", ImGuiTreeNodeFlags_NoTreePushOnOpen))
+				// Current resolution
+				if (state.decision.manualRes)
 				{
-					if (ImGui::InputInt("High FPS target", &resIncreaseThresholdFps, 1))
-						resIncreaseThreshold = std::max((float)hmdHz / (float)resIncreaseThresholdFps * 100.0f, 0.0f);
-					addTooltip("When the framerate is higher than this value, resolution is allowed to increase.");
-
-					if (ImGui::InputInt("Low FPS target", &resDecreaseThresholdFps, 1))
-						resDecreaseThreshold = std::max((float)hmdHz / (float)resDecreaseThresholdFps * 100.0f, 0.0f);
-					addTooltip("When the framerate is lower than this value, resolution starts decreasing.");
+					ImGui::Text("Resolution =");
+				}
+				else
+				{
+					ImGui::Text("%s", fmt::format("Resolution = {:.0f} ({} x {})", state.decision.newRes, state.hmdWidthRes, state.hmdHeightRes).c_str());
+				}
 
-					ImGui::InputInt("Resolution increase constant", &resIncreaseMin, 1);
-					addTooltip("Constant percentages to increase resolution when available.");
+				// Resolution adjustment status
+				if (!state.decision.adjustResolution)
+				{
+					ImGui::SameLine(0, 10);
+					if (state.decision.manualRes)
+					{
+						ImGui::PushItemWidth(192);
+						ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(0, 0));
+						if (ImGui::SliderFloat("##", &state.decision.newRes, 20.0f, 500.0f, fmt::format("%.0f ({} x {})", state.hmdWidthRes, state.hmdHeightRes).c_str(), ImGuiSliderFlags_AlwaysClamp))
+						{
+							ControllerCommand command;
+							command.type = ControllerCommand_SetResolution;
+							command.res = state.decision.newRes;
+							channels.commands.push(command);
+						}
+						ImGui::PopStyleVar();
+					}
+					else
+					{
+						ImGui::Text("(paused)");
+					}
+				}
 
-					ImGui::InputInt("Resolution decrease constant", &resDecreaseMin, 1);
-					addTooltip("Constant percentages to decrease resolution when needed.");
+				ImGui::NewLine();
 
-					ImGui::InputInt("Resolution increase scale", &resIncreaseScale, 10);
-					addTooltip("The more frametime headroom and the higher this value is, the more resolution will increase each time.");
+				// Open settings
+				bool settingsPressed = ImGui::Button("Settings", ImVec2(82, 28));
+				if (settingsPressed)
+					showSettings = true;
 
-					ImGui::InputInt("Resolution decrease scale", &resDecreaseScale, 10);
-					addTooltip("The more frametime excess and the higher this value is, the more resolution will decrease each time.");
+				// Resolution pausing
+				ImGui::SameLine();
+				const char *pauseText;
+				if (!state.decision.manualRes)
+					pauseText = "Manual resolution";
+				else
+					pauseText = "Dynamic resolution";
+				bool pausePressed = ImGui::Button(pauseText, ImVec2(142, 28));
+				if (pausePressed)
+				{
+					ControllerCommand command;
+					command.type = ControllerCommand_SetManualRes;
+					command.manualRes = !state.decision.manualRes;
+					channels.commands.push(command);
+				}
 
-					ImGui::InputFloat("Minimum CPU time threshold", &minCpuTimeThreshold, 0.1);
-					addTooltip("Don't increase resolution if the CPU frametime is below this value (useful to prevent resolution increases during loading screens).");
+				// Open graphs
+				ImGui::SameLine();
+				bool graphsPressed = ImGui::Button("Graphs", ImVec2(82, 28));
+				if (graphsPressed)
+					showGraphs = true;
 
-					ImGui::Checkbox("Reset on CPU time threshold", &resetOnThreshold);
-					addTooltip("Reset the resolution to the initial resolution whenever the \"Minimum CPU time threshold\" is met.");
-				}
+				// Stop creating the main window
+				ImGui::End();
 			}
+#pragma endregion
 
-			if (ImGui::CollapsingHeader("Reprojection"))
+#pragma region Graphs window
+			if (showGraphs)
 			{
-				if (ImGui::InputInt("Minimum reprojection", &alwaysReproject, 1))
-					alwaysReproject = std::clamp(alwaysReproject, 0, maxReprojectionCount);
-				addTooltip("Always scale the target frametime at least according to this factor.");
+				// Create the graphs window
+				ImGui::Begin("Graphs", NULL, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoScrollbar);
+
+				// Set position and size to fill the viewport
+				ImGui::SetWindowPos(ImVec2(0, 0));
+				ImGui::SetWindowSize(ImVec2(mainWindowWidth, mainWindowHeight));
+
+				// Title
+				ImGui::Text("Graphs");
+				ImGui::SameLine(mainWindowWidth - 120);
+				int graphWindow = std::find(graphWindowLengths, graphWindowLengths + graphWindowCount, graphWindowSeconds) - graphWindowLengths;
+				ImGui::PushItemWidth(72);
+				if (ImGui::Combo("##window", &graphWindow, graphWindowNames, graphWindowCount))
+					graphWindowSeconds = graphWindowLengths[graphWindow];
+				ImGui::PopItemWidth();
+				addTooltip("Time span shown by the graphs. Saved with the settings.");
+
+				ImGui::Separator();
+
+				// Frametimes and their targets
+				ImGui::Text("%s", fmt::format("Frametime: GPU {:.2f} ms, CPU {:.2f} ms", state.decision.gpuTime, state.decision.cpuTime).c_str());
+				addTooltip("GPU frametime in green, CPU frametime in blue and the frametime targets in gray. Each pixel shows the fastest and slowest frames of its time span.");
+				const MetricSeries frametimeSeries[] = {MetricSeries_TargetLow, MetricSeries_TargetHigh, MetricSeries_CpuTime, MetricSeries_GpuTime};
+				const ImU32 frametimeColours[] = {IM_COL32(110, 110, 110, 255), IM_COL32(110, 110, 110, 255), IM_COL32(80, 150, 240, 255), IM_COL32(90, 220, 110, 255)};
+				drawMetricGraph(frametimeSeries, frametimeColours, 4, graphWindowSeconds, state.decision.hmdFrametime, "ms");
+
+				// Resolution
+				ImGui::Text("%s", fmt::format("Resolution: {:.0f}", state.decision.newRes).c_str());
+				const MetricSeries resolutionSeries[] = {MetricSeries_Resolution};
+				const ImU32 resolutionColours[] = {IM_COL32(230, 190, 80, 255)};
+				drawMetricGraph(resolutionSeries, resolutionColours, 1, graphWindowSeconds, (float)state.maxRes, "%");
+
+				// VRAM usage
+				if (state.vramMonitored)
+				{
+					ImGui::Text("%s", fmt::format("VRAM usage: {:.2f} GB", state.decision.vramUsedGB).c_str());
+					const MetricSeries vramSeries[] = {MetricSeries_VramUsedGB};
+					const ImU32 vramColours[] = {IM_COL32(200, 110, 220, 255)};
+					drawMetricGraph(vramSeries, vramColours, 1, graphWindowSeconds, state.vramTotalGB, "GB");
+				}
+				else
+				{
+					ImGui::Text("VRAM usage: Disabled");
+				}
 
-				ImGui::Checkbox("Prefer reprojection", &preferReprojection);
-				addTooltip("If enabled, scale the target frametime as soon as the CPU frametime is over the initial target frametime. Else, only scale the target frametime if the CPU frametime is over double, triple, etc. the initial target frametime.");
+				// Back to the main window
+				bool closePressed = ImGui::Button("Close", ImVec2(82, 28));
+				if (closePressed)
+					showGraphs = false;
 
-				ImGui::Checkbox("Never reproject", &ignoreCpuTime);
-				addTooltip("Never scale the target frametime depending on the CPU frametime (stops both behaviours described in \"Prefer reprojection\" tooltip; \"Minimum reprojection\" will still work).");
+				// Stop creating the graphs window
+				ImGui::End();
 			}
+#pragma endregion
 
-			if (ImGui::CollapsingHeader("VRAM"))
+#pragma region Settings window
+			if (showSettings)
 			{
-				ImGui::Checkbox("VRAM monitor enabled", &vramMonitorEnabled);
-				addTooltip("Enable VRAM specific features. If disabled, it is assumed that free VRAM is always available.");
+				// Create the settings window
+				ImGui::Begin("Settings", NULL, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove);
 
-				ImGui::Checkbox("VRAM-only mode", &vramOnlyMode);
-				addTooltip("Always stay at the initial resolution or lower based off available VRAM alone (ignoring frametimes).");
+				// Set position and size to fill the viewport
+				ImGui::SetWindowPos(ImVec2(0, 0));
+				ImGui::SetWindowSize(ImVec2(mainWindowWidth, mainWindowHeight));
 
-				if (ImGui::InputInt("VRAM target", &vramTarget, 2))
-					vramTarget = std::clamp(vramTarget, 0, 100);
-				addTooltip("Resolution stops increasing once VRAM usage exceeds this percentage.");
+				// Set the labels' width
+				ImGui::PushItemWidth(96);
 
-				if (ImGui::InputInt("VRAM limit", &vramLimit, 2))
-					vramLimit = std::clamp(vramLimit, 0, 100);
-				addTooltip("Resolution starts descreasing once VRAM usage exceeds this percentage.");
+				// Title
+				ImGui::Text("Settings");
 
-				ImGui::InputInt("GPU Index", &gpuIndex, 1);
-				addTooltip("The index of the GPU to use for VRAM monitoring. Only useful in systems with multiple GPUs. Needs restart to take effect.");
-			}
+				ImGui::Separator();
+				ImGui::NewLine();
 
-			if (ImGui::CollapsingHeader("Debug"))
-			{
-				ImGui::Checkbox("Debug Enabled", &debugEnabled);
-				addTooltip("Enable debug features. Can be used to test configs and for development. This should not be enabled during normal use.");
+				// GUI settings inputs (labels, tooltips and ranges are in settingSchema)
+				if (ImGui::CollapsingHeader("Startup"))
+				{
+					settingsEdited |= drawSetting<settingIndex("autoStart")>();
+					settingsEdited |= drawSetting<settingIndex("minimizeOnStart")>();
+					settingsEdited |= drawSetting<settingIndex("headless")>();
+				}
 
-				ImGui::InputFloat("GPU Frametime", &debugGpuFrametime, 0.5f);
-				addTooltip("Overrides the actual GPU frametime by this value when debug is enabled.");
+				if (ImGui::CollapsingHeader("General"))
+				{
+					settingsEdited |= drawSetting<settingIndex("closeToTray")>();
+					settingsEdited |= drawSetting<settingIndex("externalResChangeCompatibility")>();
+
+					ImGui::Text("Blacklist");
+					addTooltip("Don't allow resolution changes in blacklisted applications.");
+					settingsEdited |= drawSetting<settingIndex("disabledApps")>();
+					if (ImGui::Button("Blacklist current app", ImVec2(160, 26)))
+					{
+						std::string appKey = state.appKey;
+						if (!isApplicationBlacklisted(settings, appKey))
+						{
+							settings.blacklistAppsSet.insert(appKey);
+							if (blacklistApps != "")
+								blacklistApps += "\n";
+							blacklistApps += appKey;
+							settingsEdited = true;
+						}
+					}
+					addTooltip("Adds the current application to the blacklist.");
 
-				ImGui::InputFloat("CPU Frametime", &debugCpuFrametime, 0.5f);
-				addTooltip("Overrides the actual CPU frametime by this value when debug is enabled.");
+					settingsEdited |= drawSetting<settingIndex("whitelistEnabled")>();
+					settingsEdited |= drawSetting<settingIndex("whitelistApps")>();
+					if (ImGui::Button("Whitelist current app", ImVec2(164, 26)))
+					{
+						std::string appKey = state.appKey;
+						if (!isApplicationWhitelisted(settings, appKey))
+						{
+							settings.whitelistAppsSet.insert(appKey);
+							if (whitelistApps != "")
+								whitelistApps += "\n";
+							whitelistApps += appKey;
+							settingsEdited = true;
+						}
+					}
+					addTooltip("Adds the current application to the whitelist.");
+				}
 
-				ImGui::InputFloat("VRAM Usage", &debugVramUsage, 0.01f);
-				addTooltip("Overrides the actual VRAM usage by this value (0.5 = 50% VRAM usage) when debug is enabled.");
-			}
+				if (ImGui::CollapsingHeader("Resolution"))
+				{
+					settingsEdited |= drawSetting<settingIndex("resChangeDelayMs")>();
+					settingsEdited |= drawSetting<settingIndex("adaptiveResChangeDelay")>();
+					if (settings.adaptiveResChangeDelay && drawSetting<settingIndex("resChangeDelayMinMs")>())
+					{
+						settings.resChangeDelayMinMs = std::min(settings.resChangeDelayMinMs, settings.resChangeDelayMs);
+						settingsEdited = true;
+					}
 
-			ImGui::NewLine();
+					settingsEdited |= drawSetting<settingIndex("emergencyDownscale")>();
+					if (settings.emergencyDownscale)
+						settingsEdited |= drawSetting<settingIndex("emergencyMaxCut")>();
 
-			// Save settings
-			bool closePressed = ImGui::Button("Close", ImVec2(82, 28));
-			if (closePressed)
-			{
-				showSettings = false;
-			}
-			ImGui::SameLine();
-			pushRedButtonColour();
-			bool revertPressed = ImGui::Button("Revert", ImVec2(82, 28));
-			if (revertPressed)
-			{
-				loadSettings();
-			}
-			ImGui::PopStyleColor(3); // pushRedButtonColour();
-			ImGui::SameLine();
-			pushGreenButtonColour();
-			bool savePressed = ImGui::Button("Save", ImVec2(82, 28));
-			if (savePressed)
-			{
-				saveSettings();
-				if (prevAutoStart != autoStart)
+					settingsEdited |= drawSetting<settingIndex("initialRes")>();
+					settingsEdited |= drawSetting<settingIndex("minRes")>();
+					settingsEdited |= drawSetting<settingIndex("maxRes")>();
+					settingsEdited |= drawSetting<settingIndex("appProfiles")>();
+
+					settingsEdited |= drawSetting<settingIndex("controllerMode")>();
+					if (settings.controllerMode == ControllerMode_Pid)
+					{
+						settingsEdited |= drawSetting<settingIndex("pidKp")>();
+						settingsEdited |= drawSetting<settingIndex("pidKi")>();
+						settingsEdited |= drawSetting<settingIndex("pidKd")>();
+						settingsEdited |= drawSetting<settingIndex("pidDerivativeFilter")>();
+					}
+					else if (settings.controllerMode == ControllerMode_Model)
+					{
+						settingsEdited |= drawSetting<settingIndex("modelForgetting")>();
+					}
+
+					if (ImGui::TreeNodeEx("Advanced", ImGuiTreeNodeFlags_NoTreePushOnOpen))
+					{
+						settingsEdited |= inputFpsTarget("High FPS target", settings.resIncreaseThreshold, state.decision.hmdHz);
+						addTooltip("When the framerate is higher than this value, resolution is allowed to increase.");
+
+						settingsEdited |= inputFpsTarget("Low FPS target", settings.resDecreaseThreshold, state.decision.hmdHz);
+						addTooltip("When the framerate is lower than this value, resolution starts decreasing.");
+
+						settingsEdited |= drawSetting<settingIndex("resIncreaseMin")>();
+						settingsEdited |= drawSetting<settingIndex("resDecreaseMin")>();
+						settingsEdited |= drawSetting<settingIndex("resIncreaseScale")>();
+						settingsEdited |= drawSetting<settingIndex("resDecreaseScale")>();
+						settingsEdited |= drawSetting<settingIndex("minCpuTimeThreshold")>();
+						settingsEdited |= drawSetting<settingIndex("resetOnThreshold")>();
+						settingsEdited |= drawSetting<settingIndex("frametimeEstimator")>();
+						settingsEdited |= drawSetting<settingIndex("bottleneckAware")>();
+					}
+				}
+
+				if (ImGui::CollapsingHeader("Reprojection"))
 				{
-					handle_setup(autoStart);
-					prevAutoStart = autoStart;
+					settingsEdited |= drawSetting<settingIndex("alwaysReproject")>();
+					settingsEdited |= drawSetting<settingIndex("preferReprojection")>();
+					settingsEdited |= drawSetting<settingIndex("ignoreCpuTime")>();
 				}
-			}
-			ImGui::PopStyleColor(3); // pushGreenButtonColour();
 
-			// Stop creating the settings window
-			ImGui::End();
-		}
-#pragma endregion
-		ImGui::PopStyleColor(3); // pushGrayButtonColour();
+				if (ImGui::CollapsingHeader("VRAM"))
+				{
+					settingsEdited |= drawSetting<settingIndex("vramMonitorEnabled")>();
+					settingsEdited |= drawSetting<settingIndex("vramOnlyMode")>();
+					settingsEdited |= drawSetting<settingIndex("vramTarget")>();
+					settingsEdited |= drawSetting<settingIndex("vramLimit")>();
+					settingsEdited |= drawSetting<settingIndex("vramAppOnly")>();
+					settingsEdited |= drawSetting<settingIndex("vramHeadroomGB")>();
+					settingsEdited |= drawSetting<settingIndex("gpuIndex")>();
+				}
 
-		ImGui::PopStyleColor(); // ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(0.03, 0.03, 0.03, 1));
+				if (ImGui::CollapsingHeader("GPU"))
+				{
+					settingsEdited |= drawSetting<settingIndex("holdWhenThrottled")>();
+					settingsEdited |= drawSetting<settingIndex("gpuBusyLimit")>();
+				}
 
-		// Rendering
-		ImGui::Render();
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+				if (ImGui::CollapsingHeader("Metrics"))
+				{
+					settingsEdited |= drawSetting<settingIndex("metricsEnabled")>();
+					settingsEdited |= drawSetting<settingIndex("metricsPort")>();
+				}
 
-		glfwSwapBuffers(glfwWindow);
+				if (ImGui::CollapsingHeader("Control API"))
+				{
+					settingsEdited |= drawSetting<settingIndex("controlEnabled")>();
+				}
 
-		ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(0.03, 0.03, 0.03, 1));
-#pragma endregion
+				if (ImGui::CollapsingHeader("Debug"))
+				{
+					settingsEdited |= drawSetting<settingIndex("debugEnabled")>();
+					settingsEdited |= drawSetting<settingIndex("debugGpuFrametime")>();
+					settingsEdited |= drawSetting<settingIndex("debugCpuFrametime")>();
+					settingsEdited |= drawSetting<settingIndex("debugVramUsage")>();
+					settingsEdited |= drawSetting<settingIndex("traceEnabled")>();
+					settingsEdited |= drawSetting<settingIndex("traceMaxMB")>();
+
+					if (state.traceFrames > 0)
+						ImGui::Text("%s", fmt::format("Recorded frames: {}", state.traceFrames).c_str());
+				}
 
-		// Check if OpenVR is quitting so we can quit alongside it
-		VREvent_t vrEvent;
-		while (vr::VRSystem()->PollNextEvent(&vrEvent, sizeof(vr::VREvent_t)))
-		{
-			if (vrEvent.eventType == vr::VREvent_Quit)
-			{
-				vr::VRSystem()->AcknowledgeQuit_Exiting();
-				openvrQuit = true;
-				break;
+				ImGui::NewLine();
+
+				// Save settings
+				bool closePressed = ImGui::Button("Close", ImVec2(82, 28));
+				if (closePressed)
+				{
+					showSettings = false;
+				}
+				ImGui::SameLine();
+				pushRedButtonColour();
+				bool revertPressed = ImGui::Button("Revert", ImVec2(82, 28));
+				if (revertPressed)
+				{
+					loadSettings();
+					channels.appOverrides.write(appOverrides);
+					settingsEdited = true;
+				}
+				ImGui::PopStyleColor(3); // pushRedButtonColour();
+				ImGui::SameLine();
+				pushGreenButtonColour();
+				bool savePressed = ImGui::Button("Save", ImVec2(82, 28));
+				if (savePressed)
+				{
+					saveSettings();
+					if (prevAutoStart != autoStart)
+					{
+						vrRuntime->setAutoStart(autoStart);
+						prevAutoStart = autoStart;
+					}
+				}
+				ImGui::PopStyleColor(3); // pushGreenButtonColour();
+
+				// Stop creating the settings window
+				ImGui::End();
 			}
+#pragma endregion
+			ImGui::PopStyleColor(3); // pushGrayButtonColour();
+
+			ImGui::PopStyleColor(); // ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(0.03, 0.03, 0.03, 1));
+
+			// Rendering
+			ImGui::Render();
+			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+			glfwSwapBuffers(glfwWindow);
+
+			ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(0.03, 0.03, 0.03, 1));
 		}
+#pragma endregion
 
-		// Calculate how long to sleep for depending on if the window is focused or not.
+		// Send settings edits to the controller thread
+		if (settingsEdited)
+			channels.settings.write(settings);
+
+		// Sleep until the GUI needs redrawing
 		std::chrono::milliseconds sleepTime;
-		if (glfwGetWindowAttrib(glfwWindow, GLFW_FOCUSED))
+		if (guiVisible && (guiDirty || guiActive))
 			sleepTime = refreshIntervalFocused;
 		else
 			sleepTime = refreshIntervalBackground;
 
-		// ZZzzzz
-		std::this_thread::sleep_for(sleepTime);
+		// ZZzzzz (input and new stats wake the GUI up early)
+		glfwWaitEventsTimeout(std::chrono::duration<double>(sleepTime).count());
 	}
 
-	cleanup(nvmlLibrary);
+	channels.quit = true;
+	controllerThread.join();
+
+	cleanup();
 
 #if defined(_WIN32)
-	tray_exit();
+	if (!runHeadless)
+		tray_exit();
 #endif // _WIN32
 
 	return 0;
@@ -1274,6 +1927,6 @@ int main(int argc, char *argv[])
 #ifdef _WIN32
 int APIENTRY WinMain(HINSTANCE hInst, HINSTANCE hInstPrev, PSTR cmdline, int cmdshow)
 {
-	main(NULL, NULL);
+	main(__argc, __argv);
 }
 #endif
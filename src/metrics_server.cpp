@@ -0,0 +1,154 @@
+#include "metrics_server.hpp"
+
+#include <cstring>
+
+#include "sockets.hpp"
+
+// How often the text is refreshed while nobody scrapes
+static constexpr const int renderIntervalMs = 250;
+
+// Scrapers send a few hundred bytes and don't wait on the response
+static constexpr const int requestBufferSize = 2048;
+static constexpr const int clientTimeoutMs = 1000;
+
+static constexpr const char *contentType = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+MetricsServer::~MetricsServer()
+{
+	stop();
+}
+
+bool MetricsServer::start(int port, Renderer renderer)
+{
+	stop();
+
+	if (!initSockets())
+		return false;
+
+	Socket listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (listener == INVALID_SOCKET)
+	{
+		cleanupSockets();
+		return false;
+	}
+
+#ifndef _WIN32
+	// Restarting OVRDR shouldn't have to wait for the previous connections to time out
+	int reuse = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+
+	// Only reachable from this computer
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_port = htons((uint16_t)port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(listener, (sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 4) != 0)
+	{
+		closeSocket(listener);
+		cleanupSockets();
+		return false;
+	}
+
+	listenSocket = (intptr_t)listener;
+	this->renderer = renderer;
+	text = "# EOF\n";
+	quit = false;
+	thread = std::thread(&MetricsServer::serve, this);
+	return true;
+}
+
+void MetricsServer::stop()
+{
+	if (listenSocket == -1)
+		return;
+
+	quit = true;
+	if (thread.joinable())
+		thread.join();
+
+	closeSocket((Socket)listenSocket);
+	listenSocket = -1;
+	cleanupSockets();
+}
+
+void MetricsServer::serve()
+{
+	Socket listener = (Socket)listenSocket;
+	while (!quit)
+	{
+		renderer(text);
+
+		// Wait for a scrape (or the next render)
+		fd_set readSet;
+		FD_ZERO(&readSet);
+		FD_SET(listener, &readSet);
+		timeval timeout = {0, renderIntervalMs * 1000};
+		if (select((int)listener + 1, &readSet, nullptr, nullptr, &timeout) <= 0)
+			continue;
+
+		Socket client = accept(listener, nullptr, nullptr);
+		if (client == INVALID_SOCKET)
+			continue;
+		// Up to date values for this scrape
+		renderer(text);
+		handleClient((intptr_t)client);
+	}
+}
+
+void MetricsServer::handleClient(intptr_t clientSocket)
+{
+	Socket client = (Socket)clientSocket;
+
+	// Don't let a stuck client hold the server
+#ifdef _WIN32
+	DWORD timeout = clientTimeoutMs;
+#else
+	timeval timeout = {clientTimeoutMs / 1000, (clientTimeoutMs % 1000) * 1000};
+#endif
+	setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+	setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, (const char *)&timeout, sizeof(timeout));
+
+	// Read the request line and headers
+	char request[requestBufferSize];
+	int length = 0;
+	while (length < requestBufferSize - 1)
+	{
+		int received = recv(client, request + length, requestBufferSize - 1 - length, 0);
+		if (received <= 0)
+			break;
+		length += received;
+		request[length] = '\0';
+		if (std::strstr(request, "\r\n\r\n"))
+			break;
+	}
+	request[length] = '\0';
+
+	// GET /metrics, with or without a query string
+	bool isMetrics = std::strncmp(request, "GET /metrics", 12) == 0 && (request[12] == ' ' || request[12] == '?');
+
+	response.clear();
+	if (isMetrics)
+	{
+		response += "HTTP/1.1 200 OK\r\nContent-Type: ";
+		response += contentType;
+		response += "\r\nContent-Length: ";
+		response += std::to_string(text.size());
+		response += "\r\nConnection: close\r\n\r\n";
+		response += text;
+	}
+	else
+	{
+		response += "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+	}
+
+	for (size_t sent = 0; sent < response.size();)
+	{
+		int count = send(client, response.data() + sent, (int)(response.size() - sent), MSG_NOSIGNAL);
+		if (count <= 0)
+			break;
+		sent += count;
+	}
+
+	closeSocket(client);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+/**
+ * Minimal HTTP server answering GET /metrics on 127.0.0.1 with OpenMetrics text, from its own thread.
+ * The text is rendered by the server thread into a reused buffer whenever the renderer has something new,
+ * so scrapes only copy it out and never wait on (or delay) the rest of the application.
+ */
+class MetricsServer
+{
+public:
+	/// Re-renders text (cleared by the renderer) if there's something new, returns false to keep the current text
+	using Renderer = std::function<bool(std::string &text)>;
+
+	MetricsServer() = default;
+	MetricsServer(const MetricsServer &) = delete;
+	MetricsServer &operator=(const MetricsServer &) = delete;
+	~MetricsServer();
+
+	/// Starts listening on 127.0.0.1:port, returns false if the port can't be used
+	bool start(int port, Renderer renderer);
+	void stop();
+
+private:
+	void serve();
+	void handleClient(intptr_t client);
+
+	Renderer renderer;
+	std::string text;
+	std::string response;
+
+	// SOCKET on Windows, file descriptor elsewhere
+	intptr_t listenSocket = -1;
+	std::thread thread;
+	std::atomic<bool> quit{false};
+};
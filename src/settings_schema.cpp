@@ -0,0 +1,348 @@
+#include "settings_schema.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+std::set<std::string> multilineStringToSet(const std::string &val)
+{
+	std::set<std::string> set;
+	std::stringstream ss(val);
+
+	for (std::string line; std::getline(ss, line, '\n');)
+		set.insert(line);
+
+	return set;
+}
+
+std::string setToConfigString(const std::set<std::string> &valSet)
+{
+	std::string result;
+
+	for (const std::string &val : valSet)
+	{
+		result += (val + " ");
+	}
+	if (!result.empty())
+	{
+		// remove trailing space
+		result.pop_back();
+	}
+
+	return result;
+}
+
+/// Sets an app list from its space-separated ini form
+static void setAppList(const Setting &setting, const char *text)
+{
+	*setting.textValue = text;
+	std::replace(setting.textValue->begin(), setting.textValue->end(), ' ', '\n');
+	*setting.setValue = multilineStringToSet(*setting.textValue);
+}
+
+void resetSettings(const Setting *schema, int count)
+{
+	const ControllerSettings controllerDefaults;
+	for (int i = 0; i < count; i++)
+	{
+		const Setting &setting = schema[i];
+		switch (setting.type)
+		{
+		case SettingType_Bool:
+			*setting.boolValue = setting.boolMember ? controllerDefaults.*setting.boolMember : setting.defaultValue != 0;
+			break;
+		case SettingType_Int:
+			*setting.intValue = setting.intMember ? controllerDefaults.*setting.intMember : (int)setting.defaultValue;
+			break;
+		case SettingType_Float:
+			*setting.floatValue = setting.floatMember ? controllerDefaults.*setting.floatMember : setting.defaultValue;
+			break;
+		case SettingType_AppList:
+			setAppList(setting, setting.setMember ? setToConfigString(controllerDefaults.*setting.setMember).c_str() : setting.defaultText);
+			break;
+		}
+	}
+}
+
+/// The setting, pointing at value instead of where it lives
+static Setting settingIn(const Setting &setting, SettingValue &value)
+{
+	Setting copy = setting;
+	copy.boolValue = &value.boolValue;
+	copy.intValue = &value.intValue;
+	copy.floatValue = &value.floatValue;
+	copy.textValue = &value.textValue;
+	copy.setValue = &value.setValue;
+	return copy;
+}
+
+static void saveSetting(const Setting &setting, SettingValue &value)
+{
+	switch (setting.type)
+	{
+	case SettingType_Bool:
+		value.boolValue = *setting.boolValue;
+		break;
+	case SettingType_Int:
+		value.intValue = *setting.intValue;
+		break;
+	case SettingType_Float:
+		value.floatValue = *setting.floatValue;
+		break;
+	case SettingType_AppList:
+		value.textValue = *setting.textValue;
+		value.setValue = *setting.setValue;
+		break;
+	}
+}
+
+static void loadSetting(const Setting &setting, const SettingValue &value)
+{
+	switch (setting.type)
+	{
+	case SettingType_Bool:
+		*setting.boolValue = value.boolValue;
+		break;
+	case SettingType_Int:
+		*setting.intValue = value.intValue;
+		break;
+	case SettingType_Float:
+		*setting.floatValue = value.floatValue;
+		break;
+	case SettingType_AppList:
+		*setting.textValue = value.textValue;
+		*setting.setValue = value.setValue;
+		break;
+	}
+}
+
+static bool settingValuesEqual(const Setting &setting, const SettingValue &a, const SettingValue &b)
+{
+	switch (setting.type)
+	{
+	case SettingType_Bool:
+		return a.boolValue == b.boolValue;
+	case SettingType_Int:
+		return a.intValue == b.intValue;
+	case SettingType_Float:
+		return a.floatValue == b.floatValue;
+	case SettingType_AppList:
+		// Not the text, so lists that only differ by their order in the GUI are left alone
+		return a.setValue == b.setValue;
+	}
+	return true;
+}
+
+static bool settingEquals(const Setting &setting, const SettingValue &value)
+{
+	SettingValue current;
+	saveSetting(setting, current);
+	return settingValuesEqual(setting, current, value);
+}
+
+/// Parses the text of a setting in the ini file into value, clamped to its range. Returns false if it's malformed.
+static bool parseSetting(const Setting &setting, const char *text, SettingValue &value)
+{
+	Setting target = settingIn(setting, value);
+	char *end;
+	switch (setting.type)
+	{
+	case SettingType_Bool:
+	{
+		long number = std::strtol(text, &end, 10);
+		if (end == text)
+			return false;
+		value.boolValue = number != 0;
+		break;
+	}
+	case SettingType_Int:
+	{
+		long number = std::strtol(text, &end, 10);
+		if (end == text)
+			return false;
+		value.intValue = (int)number;
+		break;
+	}
+	case SettingType_Float:
+	{
+		float number = std::strtof(text, &end);
+		if (end == text)
+			return false;
+		value.floatValue = number;
+		break;
+	}
+	case SettingType_AppList:
+		setAppList(target, text);
+		break;
+	}
+	clampSetting(target);
+	return true;
+}
+
+int readSettings(const CSimpleIniA &ini, const Setting *schema, int count, bool *changed)
+{
+	int changedCount = 0;
+	SettingValue value;
+	for (int i = 0; i < count; i++)
+	{
+		const Setting &setting = schema[i];
+		const char *text = ini.GetValue(setting.section, setting.key, nullptr);
+		if (!text || !parseSetting(setting, text, value) || settingEquals(setting, value))
+			continue;
+
+		loadSetting(setting, value);
+		changedCount++;
+		if (changed)
+			changed[i] = true;
+	}
+	return changedCount;
+}
+
+void saveSettingValues(const CSimpleIniA &ini, const Setting *schema, int count, SettingValue *values)
+{
+	for (int i = 0; i < count; i++)
+	{
+		const Setting &setting = schema[i];
+		saveSetting(setting, values[i]);
+		const char *text = ini.GetValue(setting.section, setting.key, nullptr);
+		if (text)
+			parseSetting(setting, text, values[i]);
+	}
+}
+
+int readEditedSettings(const CSimpleIniA &ini, const Setting *schema, int count, SettingValue *values, bool *changed)
+{
+	int changedCount = 0;
+	SettingValue value;
+	for (int i = 0; i < count; i++)
+	{
+		const Setting &setting = schema[i];
+		const char *text = ini.GetValue(setting.section, setting.key, nullptr);
+		if (!text || !parseSetting(setting, text, value) || settingValuesEqual(setting, value, values[i]))
+			continue;
+
+		// Edited in the file, which takes precedence over edits made since it was read
+		values[i] = value;
+		if (settingEquals(setting, value))
+			continue;
+		loadSetting(setting, value);
+		changedCount++;
+		if (changed)
+			changed[i] = true;
+	}
+	return changedCount;
+}
+
+void writeSettings(CSimpleIniA &ini, const Setting *schema, int count)
+{
+	char text[32];
+	for (int i = 0; i < count; i++)
+	{
+		const Setting &setting = schema[i];
+		switch (setting.type)
+		{
+		case SettingType_Bool:
+			std::snprintf(text, sizeof(text), "%d", *setting.boolValue ? 1 : 0);
+			ini.SetValue(setting.section, setting.key, text);
+			break;
+		case SettingType_Int:
+			std::snprintf(text, sizeof(text), "%d", *setting.intValue);
+			ini.SetValue(setting.section, setting.key, text);
+			break;
+		case SettingType_Float:
+			std::snprintf(text, sizeof(text), "%f", *setting.floatValue);
+			ini.SetValue(setting.section, setting.key, text);
+			break;
+		case SettingType_AppList:
+			ini.SetValue(setting.section, setting.key, setToConfigString(*setting.setValue).c_str());
+			break;
+		}
+	}
+}
+
+void clampSetting(const Setting &setting)
+{
+	if (setting.type == SettingType_Int)
+	{
+		// Limits past what an int holds are no limit
+		if (setting.min > -settingNoLimit)
+			*setting.intValue = std::max(*setting.intValue, (int)setting.min);
+		if (setting.max < settingNoLimit)
+			*setting.intValue = std::min(*setting.intValue, (int)setting.max);
+	}
+	else if (setting.type == SettingType_Float)
+	{
+		*setting.floatValue = std::clamp(*setting.floatValue, setting.min, setting.max);
+	}
+}
+
+std::vector<AppOverride> readAppOverrides(const CSimpleIniA &ini, const Setting *schema, int count)
+{
+	CSimpleIniA::TNamesDepend sections;
+	ini.GetAllSections(sections);
+	sections.sort(CSimpleIniA::Entry::LoadOrder());
+
+	std::vector<AppOverride> appOverrides;
+	size_t prefixLength = std::strlen(appSectionPrefix);
+	for (const CSimpleIniA::Entry &section : sections)
+	{
+		if (std::strncmp(section.pItem, appSectionPrefix, prefixLength) != 0 || section.pItem[prefixLength] == '\0')
+			continue;
+
+		AppOverride appOverride;
+		appOverride.pattern = section.pItem + prefixLength;
+		for (int i = 0; i < count; i++)
+		{
+			const Setting &setting = schema[i];
+			if (!setting.perApp)
+				continue;
+			const char *text = ini.GetValue(section.pItem, setting.key, nullptr);
+			if (!text)
+				continue;
+
+			char *end;
+			float value = setting.type == SettingType_Float ? std::strtof(text, &end) : (float)std::strtol(text, &end, 10);
+			if (end == text)
+				continue;
+			appOverride.settings.push_back(i);
+			appOverride.values.push_back(value);
+		}
+		appOverrides.push_back(appOverride);
+	}
+
+	std::stable_partition(appOverrides.begin(), appOverrides.end(), [](const AppOverride &appOverride)
+						  { return appOverride.pattern.find_first_of("*?") != std::string::npos; });
+	return appOverrides;
+}
+
+void applyAppOverride(const AppOverride &appOverride, const Setting *schema, ControllerSettings &target)
+{
+	for (size_t i = 0; i < appOverride.settings.size(); i++)
+	{
+		// The setting, pointing at its member of target
+		Setting setting = schema[appOverride.settings[i]];
+		float value = appOverride.values[i];
+		if (setting.type == SettingType_Bool && setting.boolMember)
+		{
+			setting.boolValue = &(target.*setting.boolMember);
+			*setting.boolValue = value != 0;
+		}
+		else if (setting.type == SettingType_Int && setting.intMember)
+		{
+			setting.intValue = &(target.*setting.intMember);
+			*setting.intValue = (int)value;
+		}
+		else if (setting.type == SettingType_Float && setting.floatMember)
+		{
+			setting.floatValue = &(target.*setting.floatMember);
+			*setting.floatValue = value;
+		}
+		else
+		{
+			continue;
+		}
+		clampSetting(setting);
+	}
+}
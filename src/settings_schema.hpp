@@ -0,0 +1,276 @@
+#pragma once
+
+#include <limits>
+#include <set>
+#include <string>
+#include <vector>
+
+// Loading and saving .ini configuration file
+#include "SimpleIni.h"
+
+#include "controller.hpp"
+
+enum SettingType
+{
+	SettingType_Bool,
+	SettingType_Int,
+	SettingType_Float,
+	// Application keys, space-separated in the ini file and newline-separated in the GUI
+	SettingType_AppList,
+};
+
+/// How a setting is edited in the GUI
+enum SettingWidget
+{
+	// Edited by custom GUI code (or not at all)
+	SettingWidget_None,
+	SettingWidget_Checkbox,
+	SettingWidget_InputInt,
+	SettingWidget_InputFloat,
+	SettingWidget_Combo,
+	SettingWidget_Radio,
+	SettingWidget_AppList,
+};
+
+static constexpr const float settingNoLimit = std::numeric_limits<float>::infinity();
+
+// Sections of per-application overrides ([App:<key or pattern>])
+static constexpr const char *appSectionPrefix = "App:";
+
+/// Describes a setting: where it's stored in settings.ini and in memory, its default and range, and its GUI widget
+struct Setting
+{
+	const char *section = nullptr;
+	const char *key = nullptr;
+	SettingType type = SettingType_Bool;
+
+	// Where the value lives (the one matching type)
+	bool *boolValue = nullptr;
+	int *intValue = nullptr;
+	float *floatValue = nullptr;
+	// App list text edited in the GUI and the set of keys used by the controller
+	std::string *textValue = nullptr;
+	std::set<std::string> *setValue = nullptr;
+	// Member the value is, for the settings of the resolution controller (their defaults are ControllerSettings{}'s)
+	bool ControllerSettings::*boolMember = nullptr;
+	int ControllerSettings::*intMember = nullptr;
+	float ControllerSettings::*floatMember = nullptr;
+	std::set<std::string> ControllerSettings::*setMember = nullptr;
+
+	// Default and range of numbers (inclusive), default text of app lists
+	float defaultValue = 0;
+	float min = -settingNoLimit;
+	float max = settingNoLimit;
+	const char *defaultText = "";
+
+	// GUI
+	SettingWidget widget = SettingWidget_None;
+	const char *label = nullptr;
+	const char *tooltip = nullptr;
+	float step = 0;
+	const char *format = "%.3f";
+	// Choices of combos and radio buttons (the value is the index)
+	const char *const *names = nullptr;
+	int nameCount = 0;
+
+	// Whether it can be overridden in [App:] sections (only settings of the resolution controller)
+	bool perApp = false;
+};
+
+/// Settings of an [App:] section, applied over the global settings while a matching application runs
+struct AppOverride
+{
+	// Application key, or a pattern where '*' matches any number of characters and '?' any single one
+	std::string pattern;
+	// Indexes into the schema, and the values they're set to
+	std::vector<int> settings;
+	std::vector<float> values;
+
+	bool operator==(const AppOverride &other) const
+	{
+		return pattern == other.pattern && settings == other.settings && values == other.values;
+	}
+};
+
+/// Copy of the value of a setting
+struct SettingValue
+{
+	bool boolValue = false;
+	int intValue = 0;
+	float floatValue = 0;
+	std::string textValue;
+	std::set<std::string> setValue;
+};
+
+constexpr Setting boolSetting(const char *section, const char *key, bool *value, bool defaultValue, const char *label, const char *tooltip)
+{
+	Setting setting;
+	setting.section = section;
+	setting.key = key;
+	setting.type = SettingType_Bool;
+	setting.boolValue = value;
+	setting.defaultValue = defaultValue;
+	setting.widget = label ? SettingWidget_Checkbox : SettingWidget_None;
+	setting.label = label;
+	setting.tooltip = tooltip;
+	return setting;
+}
+
+constexpr Setting intSetting(const char *section, const char *key, int *value, int defaultValue, float min, float max, int step, const char *label, const char *tooltip)
+{
+	Setting setting;
+	setting.section = section;
+	setting.key = key;
+	setting.type = SettingType_Int;
+	setting.intValue = value;
+	setting.defaultValue = defaultValue;
+	setting.min = min;
+	setting.max = max;
+	setting.widget = label ? SettingWidget_InputInt : SettingWidget_None;
+	setting.label = label;
+	setting.tooltip = tooltip;
+	setting.step = step;
+	return setting;
+}
+
+constexpr Setting floatSetting(const char *section, const char *key, float *value, float defaultValue, float min, float max, float step, const char *label, const char *tooltip, const char *format = "%.3f")
+{
+	Setting setting;
+	setting.section = section;
+	setting.key = key;
+	setting.type = SettingType_Float;
+	setting.floatValue = value;
+	setting.defaultValue = defaultValue;
+	setting.min = min;
+	setting.max = max;
+	setting.widget = label ? SettingWidget_InputFloat : SettingWidget_None;
+	setting.label = label;
+	setting.tooltip = tooltip;
+	setting.step = step;
+	setting.format = format;
+	return setting;
+}
+
+/// An index into names, edited with a combo (or radio buttons)
+constexpr Setting choiceSetting(const char *section, const char *key, int *value, int defaultValue, const char *const *names, int nameCount, const char *label, const char *tooltip, SettingWidget widget = SettingWidget_Combo)
+{
+	Setting setting = intSetting(section, key, value, defaultValue, 0, nameCount - 1, 1, label, tooltip);
+	setting.widget = widget;
+	setting.names = names;
+	setting.nameCount = nameCount;
+	return setting;
+}
+
+constexpr Setting appListSetting(const char *section, const char *key, std::string *text, std::set<std::string> *set, const char *defaultText, const char *label, const char *tooltip)
+{
+	Setting setting;
+	setting.section = section;
+	setting.key = key;
+	setting.type = SettingType_AppList;
+	setting.textValue = text;
+	setting.setValue = set;
+	setting.defaultText = defaultText;
+	setting.widget = SettingWidget_AppList;
+	setting.label = label;
+	setting.tooltip = tooltip;
+	return setting;
+}
+
+/// A setting of the resolution controller, stored in settings
+constexpr Setting boolSetting(const char *section, const char *key, ControllerSettings &settings, bool ControllerSettings::*member, const char *label, const char *tooltip)
+{
+	Setting setting = boolSetting(section, key, &(settings.*member), false, label, tooltip);
+	setting.boolMember = member;
+	return setting;
+}
+
+constexpr Setting intSetting(const char *section, const char *key, ControllerSettings &settings, int ControllerSettings::*member, float min, float max, int step, const char *label, const char *tooltip)
+{
+	Setting setting = intSetting(section, key, &(settings.*member), 0, min, max, step, label, tooltip);
+	setting.intMember = member;
+	return setting;
+}
+
+constexpr Setting floatSetting(const char *section, const char *key, ControllerSettings &settings, float ControllerSettings::*member, float min, float max, float step, const char *label, const char *tooltip, const char *format = "%.3f")
+{
+	Setting setting = floatSetting(section, key, &(settings.*member), 0, min, max, step, label, tooltip, format);
+	setting.floatMember = member;
+	return setting;
+}
+
+constexpr Setting choiceSetting(const char *section, const char *key, ControllerSettings &settings, int ControllerSettings::*member, const char *const *names, int nameCount, const char *label, const char *tooltip, SettingWidget widget = SettingWidget_Combo)
+{
+	Setting setting = choiceSetting(section, key, &(settings.*member), 0, names, nameCount, label, tooltip, widget);
+	setting.intMember = member;
+	return setting;
+}
+
+constexpr Setting appListSetting(const char *section, const char *key, std::string *text, ControllerSettings &settings, std::set<std::string> ControllerSettings::*member, const char *label, const char *tooltip)
+{
+	Setting setting = appListSetting(section, key, text, &(settings.*member), "", label, tooltip);
+	setting.setMember = member;
+	return setting;
+}
+
+/// Lets a setting of the resolution controller (built from its ControllerSettings member) be overridden per application
+constexpr Setting perAppSetting(Setting setting)
+{
+	setting.perApp = true;
+	return setting;
+}
+
+constexpr bool settingKeysEqual(const char *a, const char *b)
+{
+	while (*a && *a == *b)
+	{
+		a++;
+		b++;
+	}
+	return *a == *b;
+}
+
+/// Index of the setting with this key in schema, -1 if there's none (can be evaluated at compile time)
+constexpr int findSetting(const Setting *schema, int count, const char *key)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (settingKeysEqual(schema[i].key, key))
+			return i;
+	}
+	return -1;
+}
+
+/// Newline-delimited string to a set
+std::set<std::string> multilineStringToSet(const std::string &val);
+
+/// Set to a space-delimited string
+std::string setToConfigString(const std::set<std::string> &valSet);
+
+/// Sets every setting to its default
+void resetSettings(const Setting *schema, int count);
+
+/**
+ * Reads the settings found in ini, clamped to their range (missing and malformed ones are left as they are).
+ * Returns how many settings got a different value, which are also flagged in changed (of count elements) if given.
+ */
+int readSettings(const CSimpleIniA &ini, const Setting *schema, int count, bool *changed = nullptr);
+
+/// Copies the settings to values (of count elements), as found in ini where it has them, to tell which ones get edited in the file later on
+void saveSettingValues(const CSimpleIniA &ini, const Setting *schema, int count, SettingValue *values);
+
+/**
+ * Like readSettings, but only reads the settings whose value in ini differs from values (saved by saveSettingValues),
+ * so the other ones keep what they were set to since. values gets the new ones.
+ */
+int readEditedSettings(const CSimpleIniA &ini, const Setting *schema, int count, SettingValue *values, bool *changed = nullptr);
+
+void writeSettings(CSimpleIniA &ini, const Setting *schema, int count);
+
+/// Brings a setting back within its range
+void clampSetting(const Setting &setting);
+
+/// Reads the [App:] sections of ini, patterns first so sections of a single application take precedence over them
+std::vector<AppOverride> readAppOverrides(const CSimpleIniA &ini, const Setting *schema, int count);
+
+/// Applies an override to target, through the ControllerSettings members of the schema's per-app settings
+void applyAppOverride(const AppOverride &appOverride, const Setting *schema, ControllerSettings &target);
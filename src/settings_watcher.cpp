@@ -0,0 +1,182 @@
+#include "settings_watcher.hpp"
+
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// How often quit is checked
+static constexpr const int pollIntervalMs = 50;
+// How long the file has to be left alone after a change before it's reported
+static constexpr const std::chrono::milliseconds debounceTime = std::chrono::milliseconds(250);
+
+// Enough for dozens of changes at once, more than that is treated as a change to the file
+static constexpr const int eventBufferSize = 4096;
+
+SettingsWatcher::~SettingsWatcher()
+{
+	stop();
+}
+
+bool SettingsWatcher::start(const std::string &path)
+{
+	stop();
+
+	std::error_code error;
+	std::filesystem::path absolutePath = std::filesystem::absolute(path, error);
+	if (error)
+		return false;
+	directory = absolutePath.parent_path();
+	fileName = absolutePath.filename();
+
+#ifdef _WIN32
+	HANDLE directoryHandle = CreateFileW(directory.wstring().c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+										 nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (directoryHandle == INVALID_HANDLE_VALUE)
+		return false;
+	handle = (intptr_t)directoryHandle;
+#else
+	int inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify == -1)
+		return false;
+	// Written in place (closed or still open) or replaced by a rename
+	if (inotify_add_watch(inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO) == -1)
+	{
+		close(inotify);
+		return false;
+	}
+	handle = inotify;
+#endif
+
+	quit = false;
+	changed = false;
+	thread = std::thread(&SettingsWatcher::watch, this);
+	return true;
+}
+
+void SettingsWatcher::stop()
+{
+	if (handle == -1)
+		return;
+
+	quit = true;
+	if (thread.joinable())
+		thread.join();
+
+#ifdef _WIN32
+	CloseHandle((HANDLE)handle);
+#else
+	close((int)handle);
+#endif
+	handle = -1;
+}
+
+bool SettingsWatcher::poll()
+{
+	return changed.exchange(false);
+}
+
+void SettingsWatcher::watch()
+{
+	bool pending = false;
+	auto lastChangeTime = std::chrono::steady_clock::now();
+
+#ifdef _WIN32
+	HANDLE directoryHandle = (HANDLE)handle;
+	std::wstring name = fileName.wstring();
+	alignas(DWORD) char buffer[eventBufferSize];
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	bool reading = false;
+#else
+	int inotify = (int)handle;
+	std::string name = fileName.string();
+	alignas(inotify_event) char buffer[eventBufferSize];
+#endif
+
+	while (!quit)
+	{
+		bool fileChanged = false;
+
+#ifdef _WIN32
+		if (!reading)
+		{
+			reading = ReadDirectoryChangesW(directoryHandle, buffer, sizeof(buffer), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_FILE_NAME, nullptr, &overlapped, nullptr);
+			if (!reading)
+			{
+				Sleep(pollIntervalMs);
+				continue;
+			}
+		}
+		if (WaitForSingleObject(overlapped.hEvent, pollIntervalMs) == WAIT_OBJECT_0)
+		{
+			reading = false;
+			ResetEvent(overlapped.hEvent);
+			DWORD length = 0;
+			if (GetOverlappedResult(directoryHandle, &overlapped, &length, FALSE))
+			{
+				// Nothing returned means the changes didn't fit in the buffer
+				if (length == 0)
+					fileChanged = true;
+				for (DWORD offset = 0; offset < length;)
+				{
+					const FILE_NOTIFY_INFORMATION *info = (const FILE_NOTIFY_INFORMATION *)(buffer + offset);
+					std::wstring changedName(info->FileName, info->FileNameLength / sizeof(WCHAR));
+					// Windows file names aren't case sensitive
+					if (_wcsicmp(changedName.c_str(), name.c_str()) == 0)
+						fileChanged = true;
+					if (info->NextEntryOffset == 0)
+						break;
+					offset += info->NextEntryOffset;
+				}
+			}
+		}
+#else
+		pollfd pollInfo = {inotify, POLLIN, 0};
+		if (::poll(&pollInfo, 1, pollIntervalMs) > 0)
+		{
+			ssize_t length;
+			while ((length = read(inotify, buffer, sizeof(buffer))) > 0)
+			{
+				for (ssize_t offset = 0; offset < length;)
+				{
+					const inotify_event *event = (const inotify_event *)(buffer + offset);
+					if ((event->mask & IN_Q_OVERFLOW) || (event->len > 0 && name == event->name))
+						fileChanged = true;
+					offset += sizeof(inotify_event) + event->len;
+				}
+			}
+		}
+#endif
+
+		// Report the change once writes to the file have stopped
+		auto now = std::chrono::steady_clock::now();
+		if (fileChanged)
+		{
+			pending = true;
+			lastChangeTime = now;
+		}
+		else if (pending && now - lastChangeTime >= debounceTime)
+		{
+			pending = false;
+			changed = true;
+		}
+	}
+
+#ifdef _WIN32
+	if (reading)
+	{
+		CancelIo(directoryHandle);
+		DWORD length;
+		GetOverlappedResult(directoryHandle, &overlapped, &length, TRUE);
+	}
+	CloseHandle(overlapped.hEvent);
+#endif
+}
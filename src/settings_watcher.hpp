@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+/**
+ * Watches a file for changes from its own thread, through inotify on Linux and ReadDirectoryChangesW on Windows.
+ *
+ * The file's directory is watched rather than the file itself, so files replaced by a rename
+ * (as editors and deployment tools do) keep being watched.
+ * Changes are debounced: a burst of writes is reported once, after the file has been left alone for a moment.
+ */
+class SettingsWatcher
+{
+public:
+	SettingsWatcher() = default;
+	SettingsWatcher(const SettingsWatcher &) = delete;
+	SettingsWatcher &operator=(const SettingsWatcher &) = delete;
+	~SettingsWatcher();
+
+	/// Starts watching the file at path, returns false if it can't be watched
+	bool start(const std::string &path);
+	void stop();
+
+	/// Whether the file changed since the last call (never blocks)
+	bool poll();
+
+private:
+	void watch();
+
+	std::filesystem::path directory;
+	std::filesystem::path fileName;
+
+	// inotify file descriptor, or directory HANDLE on Windows
+	intptr_t handle = -1;
+	std::thread thread;
+	std::atomic<bool> quit{false};
+	std::atomic<bool> changed{false};
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+// BSD sockets, through Winsock on Windows
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+// AF_UNIX (Windows 10 1803 and newer)
+#include <afunix.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+typedef SOCKET Socket;
+#define closeSocket closesocket
+#else
+typedef int Socket;
+static constexpr const Socket INVALID_SOCKET = -1;
+#define closeSocket close
+#endif
+
+// Writing to a closed connection shouldn't kill the process (SIGPIPE)
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/// Loads the socket library (Winsock), each successful call has to be paired with cleanupSockets
+inline bool initSockets()
+{
+#ifdef _WIN32
+	WSADATA wsaData;
+	return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#else
+	return true;
+#endif
+}
+
+inline void cleanupSockets()
+{
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+/// Makes recv, send and accept return instead of waiting
+inline bool setSocketNonBlocking(Socket socket)
+{
+#ifdef _WIN32
+	u_long nonBlocking = 1;
+	return ioctlsocket(socket, FIONBIO, &nonBlocking) == 0;
+#else
+	int flags = fcntl(socket, F_GETFL, 0);
+	return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
@@ -0,0 +1,307 @@
+// Runs the resolution controller against synthetic or recorded workloads on a simulated headset and GPU,
+// and reports how well it keeps up with them
+// Usage: ovrdr_simulator [--scenario <name|all>] [--controller <step|pid|model|all>] [--trace <trace.ovrt>] [--hz <hz>] [--seed <seed>] [--no-emergency]
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "controller.hpp"
+#include "workload.hpp"
+
+// Resolution points within which the resolution is considered settled
+static constexpr const float settleBand = 2.0f;
+
+// How often the controller thread samples frames
+static constexpr const double sampleInterval = 0.05;
+
+// The simulated application (any ID but noAppId)
+static constexpr const int simulatorAppId = 1;
+
+struct SimulatedHeadset
+{
+	float hz = 90.0f;
+	// Per-eye render target size at 100% (Valve Index)
+	uint32_t eyeWidth = 2016;
+	uint32_t eyeHeight = 2240;
+	float vramTotalGB = 12.0f;
+	// VRAM used by everything but the application
+	float vramOtherGB = 1.0f;
+
+	float megapixelsAt(float res) const
+	{
+		return 2.0f * eyeWidth * eyeHeight / 1000000.0f * res / 100.0f;
+	}
+};
+
+struct ScenarioResult
+{
+	// Longest time to settle after a disturbance, in seconds
+	double settleTime = 0;
+	// Largest resolution overshoot past where it settled, in resolution points
+	float overshoot = 0;
+	// Frames whose GPU frametime didn't fit in a refresh
+	double overBudget = 0;
+	double reprojectionRatio = 0;
+	int resChanges = 0;
+	double averageRes = 0;
+};
+
+struct ResChange
+{
+	double time;
+	float res;
+};
+
+static float resAt(const std::vector<ResChange> &timeline, double time)
+{
+	float res = timeline.front().res;
+	for (const ResChange &change : timeline)
+	{
+		if (change.time > time)
+			break;
+		res = change.res;
+	}
+	return res;
+}
+
+static void measureSettling(const std::vector<ResChange> &timeline, const Workload &workload, double duration, ScenarioResult &result)
+{
+	for (size_t i = 0; i < workload.disturbances.size(); i++)
+	{
+		double start = workload.disturbances[i];
+		double end = i + 1 < workload.disturbances.size() ? workload.disturbances[i + 1] : duration;
+		float startRes = resAt(timeline, start);
+		float finalRes = resAt(timeline, end);
+
+		// Last time the resolution came back within the band for good
+		double settledAt = start;
+		bool settled = std::fabs(startRes - finalRes) <= settleBand;
+		float minRes = startRes;
+		float maxRes = startRes;
+		for (const ResChange &change : timeline)
+		{
+			if (change.time <= start || change.time > end)
+				continue;
+			bool inBand = std::fabs(change.res - finalRes) <= settleBand;
+			if (inBand && !settled)
+				settledAt = change.time;
+			settled = inBand;
+			minRes = std::min(minRes, change.res);
+			maxRes = std::max(maxRes, change.res);
+		}
+
+		result.settleTime = std::max(result.settleTime, settledAt - start);
+		float overshoot = finalRes >= startRes ? maxRes - finalRes : finalRes - minRes;
+		result.overshoot = std::max(result.overshoot, overshoot);
+	}
+}
+
+static ScenarioResult simulate(const Workload &workload, const ControllerSettings &settings, const SimulatedHeadset &headset, unsigned seed)
+{
+	ScenarioResult result;
+	ResolutionController controller(settings.initialRes);
+	FrameHistory frameHistory;
+	std::mt19937 random(seed);
+	std::normal_distribution<float> gaussian(0.0f, 1.0f);
+
+	float res = settings.initialRes;
+	std::vector<ResChange> timeline = {{0, res}};
+	double refreshTime = 1.0 / headset.hz;
+	double time = 0;
+	double nextSampleTime = 0;
+	double lastTickTime = -1e9;
+	uint32_t frameIndex = 0;
+	int newFrames = 0;
+
+	long frames = 0;
+	long framesOverBudget = 0;
+	long presents = 0;
+	double resTime = 0;
+
+	double duration = workload.duration();
+	while (time < duration)
+	{
+		// Render a frame at the current resolution
+		WorkloadState state = workload.at(time);
+		float megapixels = headset.megapixelsAt(res);
+		float gpuTime = (state.gpuFixedMs + state.gpuMsPerMegapixel * megapixels) * std::max(1.0f + state.noise * gaussian(random), 0.1f);
+
+		// Frames that miss a refresh get reprojected
+		FrameSample frame;
+		frame.frameIndex = ++frameIndex;
+		frame.gpuTime = gpuTime;
+		frame.cpuTime = state.cpuMs;
+		frame.frameShown = std::max((int)std::ceil(std::max(gpuTime, state.cpuMs) / (refreshTime * 1000.0) - 0.001), state.steamVrThrottling ? 2 : 1);
+		frame.appCpuTime = state.cpuMs;
+		frame.clientFrameInterval = frame.frameShown * refreshTime * 1000.0;
+		frame.reprojectionFlags = vr::VRCompositor_ReprojectionAsync;
+		if (frame.frameShown > 1 && state.steamVrThrottling)
+			frame.reprojectionFlags |= std::min(frame.frameShown - 1, 15) << 8; // VRCompositor_ThrottleMask
+		else if (frame.frameShown > 1)
+			frame.reprojectionFlags |= gpuTime >= state.cpuMs ? vr::VRCompositor_ReprojectionReason_Gpu : vr::VRCompositor_ReprojectionReason_Cpu;
+		frameHistory.add(frame);
+		newFrames++;
+
+		frames++;
+		presents += frame.frameShown;
+		if (gpuTime > refreshTime * 1000.0)
+			framesOverBudget++;
+		resTime += res * frame.frameShown * refreshTime;
+		time += frame.frameShown * refreshTime;
+
+		// Controller thread
+		if (time < nextSampleTime)
+			continue;
+		nextSampleTime = time + sampleInterval;
+
+		// Emergency downscale
+		float emergencyRes = controller.checkOverload(frameHistory, newFrames, settings);
+		newFrames = 0;
+		if (emergencyRes > 0)
+		{
+			res = emergencyRes;
+			frameHistory.clear();
+			timeline.push_back({time, res});
+			result.resChanges++;
+			lastTickTime = time;
+			continue;
+		}
+
+		if ((time - lastTickTime) * 1000.0 - controller.getTickDelayMs(frameHistory, settings) <= 0)
+			continue;
+
+		ControllerInput input;
+		input.currentRes = res;
+		input.displayFrequency = headset.hz;
+		input.elapsedMs = std::min((time - lastTickTime) * 1000.0, 1e6);
+		input.renderWidth = headset.eyeWidth * std::sqrt(res / 100.0f);
+		input.renderHeight = headset.eyeHeight * std::sqrt(res / 100.0f);
+		input.frames = &frameHistory;
+		input.vramAppUsedGB = state.vramFixedGB + state.vramGBPerMegapixel * megapixels;
+		input.vramUsedGB = input.vramAppUsedGB + headset.vramOtherGB;
+		input.vramUsed = input.vramUsedGB / headset.vramTotalGB;
+		input.vramTotalGB = headset.vramTotalGB;
+		input.appId = simulatorAppId;
+		input.appSupported = true;
+		lastTickTime = time;
+
+		ControllerDecision decision = controller.update(input, settings);
+		if (decision.setResolution)
+		{
+			res = decision.newRes;
+			frameHistory.clear();
+			timeline.push_back({time, res});
+			result.resChanges++;
+		}
+	}
+
+	result.overBudget = frames ? (double)framesOverBudget / frames : 0;
+	result.reprojectionRatio = frames ? (double)presents / frames - 1 : 0;
+	result.averageRes = time > 0 ? resTime / time : res;
+	measureSettling(timeline, workload, duration, result);
+	return result;
+}
+
+static void printUsage(const char *program)
+{
+	std::printf("Usage: %s [--scenario <name|all>] [--controller <step|pid|model|all>] [--trace <trace.ovrt>] [--hz <hz>] [--seed <seed>] [--no-emergency]\n", program);
+	std::printf("Scenarios:");
+	for (const std::string &name : Workload::syntheticNames())
+		std::printf(" %s", name.c_str());
+	std::printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	std::string scenario = "all";
+	std::string controllerName = "all";
+	std::string tracePath;
+	SimulatedHeadset headset;
+	unsigned seed = 1;
+	// Leaves overloads to the regular controller alone
+	bool emergencyDownscale = true;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--scenario" && hasValue)
+			scenario = argv[++i];
+		else if (arg == "--controller" && hasValue)
+			controllerName = argv[++i];
+		else if (arg == "--trace" && hasValue)
+			tracePath = argv[++i];
+		else if (arg == "--hz" && hasValue)
+			headset.hz = std::stof(argv[++i]);
+		else if (arg == "--seed" && hasValue)
+			seed = std::stoul(argv[++i]);
+		else if (arg == "--no-emergency")
+			emergencyDownscale = false;
+		else
+		{
+			printUsage(argv[0]);
+			return arg == "--help" ? 0 : 1;
+		}
+	}
+
+	// Workloads
+	std::vector<Workload> workloads;
+	for (const std::string &name : Workload::syntheticNames())
+	{
+		if (scenario != "all" && scenario != name)
+			continue;
+		Workload workload;
+		Workload::synthetic(name, workload);
+		workloads.push_back(workload);
+	}
+	if (!tracePath.empty())
+	{
+		Workload workload;
+		if (!Workload::fromTrace(tracePath, headset.megapixelsAt(100), workload))
+		{
+			std::fprintf(stderr, "Can't read trace %s\n", tracePath.c_str());
+			return 1;
+		}
+		workloads.push_back(workload);
+	}
+	if (workloads.empty())
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	// Controllers
+	std::vector<int> controllerModes;
+	for (int mode = 0; mode < ControllerMode_Count; mode++)
+	{
+		std::string name = controllerModeNames[mode];
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		if (controllerName == "all" || controllerName == name)
+			controllerModes.push_back(mode);
+	}
+	if (controllerModes.empty())
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	std::printf("%-10s %-10s %10s %10s %12s %8s %8s %8s\n", "scenario", "controller", "settle s", "overshoot", "over budget", "reproj", "changes", "avg res");
+	for (const Workload &workload : workloads)
+	{
+		for (int mode : controllerModes)
+		{
+			ControllerSettings settings;
+			settings.controllerMode = mode;
+			settings.emergencyDownscale = emergencyDownscale;
+			ScenarioResult result = simulate(workload, settings, headset, seed);
+			std::printf("%-10s %-10s %10.1f %10.0f %11.1f%% %8.3f %8d %8.1f\n", workload.name.c_str(), controllerModeNames[mode],
+						result.settleTime, result.overshoot, result.overBudget * 100.0, result.reprojectionRatio, result.resChanges, result.averageRes);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,80 @@
+// Converts a frame trace recorded by OVRDR (Debug > Record frame trace) to CSV
+// Usage: ovrdr_trace_to_csv <trace.ovrt> [output.csv]
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "frame_trace.hpp"
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " <trace.ovrt> [output.csv]" << std::endl;
+		return 1;
+	}
+
+	std::ifstream trace(argv[1], std::ios::binary);
+	if (!trace)
+	{
+		std::cerr << "Can't open " << argv[1] << std::endl;
+		return 1;
+	}
+
+	// Header
+	FrameTraceHeader header;
+	if (!trace.read(reinterpret_cast<char *>(&header), sizeof(header)) || std::memcmp(header.magic, frameTraceMagic, sizeof(frameTraceMagic)) != 0)
+	{
+		std::cerr << argv[1] << " isn't an OVRDR frame trace" << std::endl;
+		return 1;
+	}
+	if (header.version != frameTraceVersion || header.recordSize != sizeof(FrameTraceRecord))
+	{
+		std::cerr << "Unsupported trace version " << header.version << std::endl;
+		return 1;
+	}
+
+	FILE *output = stdout;
+	if (argc >= 3)
+	{
+		output = std::fopen(argv[2], "w");
+		if (!output)
+		{
+			std::cerr << "Can't write " << argv[2] << std::endl;
+			return 1;
+		}
+	}
+
+	std::fprintf(output, "frame_index,time_s,gpu_ms,cpu_ms,compositor_cpu_ms,new_poses_ready_ms,new_frame_ready_ms,client_frame_interval_ms,"
+						 "presents,mispresented,dropped,reprojection_flags,res,vram_used,adjust_resolution,manual_res,waiting_for_frames,gpu_throttled\n");
+
+	FrameTraceRecord record;
+	uint32_t count = 0;
+	while (count < header.recordCount && trace.read(reinterpret_cast<char *>(&record), sizeof(record)))
+	{
+		// Same CPU frametime as the controller
+		float cpuTime = record.compositorRenderCpuMs + (record.newFrameReadyMs - record.newPosesReadyMs);
+		if (cpuTime < 0)
+			cpuTime = 0;
+
+		std::fprintf(output, "%u,%.6f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%u,%u,%u,0x%X,%.0f,%.4f,%d,%d,%d,%d\n",
+					 record.frameIndex, record.time, record.totalRenderGpuMs, cpuTime, record.compositorRenderCpuMs,
+					 record.newPosesReadyMs, record.newFrameReadyMs, record.clientFrameIntervalMs,
+					 record.numFramePresents, record.numMisPresented, record.numDroppedFrames, record.reprojectionFlags,
+					 record.res, record.vramUsed / 10000.0f,
+					 (record.flags & FrameTraceFlag_AdjustResolution) != 0, (record.flags & FrameTraceFlag_ManualRes) != 0, (record.flags & FrameTraceFlag_WaitingForFrames) != 0, (record.flags & FrameTraceFlag_GpuThrottled) != 0);
+		count++;
+	}
+
+	if (output != stdout)
+		std::fclose(output);
+
+	if (count < header.recordCount)
+	{
+		std::cerr << "Trace is truncated, only " << count << " of " << header.recordCount << " frames were read" << std::endl;
+		return 1;
+	}
+	return 0;
+}
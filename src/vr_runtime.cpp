@@ -0,0 +1,239 @@
+#include "vr_runtime.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+#include "setup.hpp"
+
+// Everything is read again this often anyway, in case an event was missed
+static constexpr const std::chrono::seconds cacheLifetime = std::chrono::seconds(5);
+
+// Smallest change of SteamVR's resolution (1 = 100%) taken as set by someone else
+static constexpr const float externalChangeTolerance = 0.00001f;
+
+/// State cached by OpenVrRuntime, each flag set when it has to be read again
+enum CachedState : uint32_t
+{
+	CachedState_SupersampleScale = 1 << 0,
+	CachedState_ManualOverride = 1 << 1,
+	CachedState_DisplayFrequency = 1 << 2,
+	CachedState_RenderTargetSize = 1 << 3,
+	CachedState_SceneApplication = 1 << 4,
+	CachedState_Dashboard = 1 << 5,
+	CachedState_All = (1 << 6) - 1,
+};
+
+/**
+ * VrRuntime talking to SteamVR.
+ * Every call to vrserver is a round trip between processes, so the state is cached,
+ * and only read again when an event (handled in pollQuit) says it changed.
+ */
+class OpenVrRuntime : public VrRuntime
+{
+public:
+	std::string init() override
+	{
+		vr::EVRInitError initError;
+		vr::VR_Init(&initError, vr::VRApplication_Overlay);
+		if (initError)
+			return vr::VR_GetVRInitErrorAsEnglishDescription(initError);
+		if (!vr::VRCompositor())
+		{
+			vr::VR_Shutdown();
+			return "Failed to initialize VR compositor.";
+		}
+		initialized = true;
+		stale = CachedState_All;
+		staleTime = std::chrono::steady_clock::now();
+		return "";
+	}
+
+	void shutdown() override
+	{
+		if (!initialized)
+			return;
+		vr::VR_Shutdown();
+		initialized = false;
+	}
+
+	float getSupersampleScale() override
+	{
+		if (refresh(CachedState_SupersampleScale))
+		{
+			float scale = vr::VRSettings()->GetFloat(vr::k_pch_SteamVR_Section, vr::k_pch_SteamVR_SupersampleScale_Float);
+			// Anything but what was last set or seen was set by someone else (allowing for rounding by SteamVR)
+			if (supersampleScaleKnown && std::fabs(scale - supersampleScale) > externalChangeTolerance)
+				externalResolutionChange = true;
+			supersampleScale = scale;
+			supersampleScaleKnown = true;
+		}
+		return supersampleScale;
+	}
+
+	void setSupersampleScale(float scale) override
+	{
+		vr::VRSettings()->SetFloat(vr::k_pch_SteamVR_Section, vr::k_pch_SteamVR_SupersampleScale_Float, scale);
+		supersampleScale = scale;
+		supersampleScaleKnown = true;
+		stale &= ~CachedState_SupersampleScale;
+		stale |= CachedState_RenderTargetSize;
+	}
+
+	bool getSupersampleManualOverride() override
+	{
+		if (refresh(CachedState_ManualOverride))
+			manualOverride = vr::VRSettings()->GetInt32(vr::k_pch_SteamVR_Section, vr::k_pch_SteamVR_SupersampleManualOverride_Bool);
+		return manualOverride;
+	}
+
+	void setSupersampleManualOverride(bool manual) override
+	{
+		vr::VRSettings()->SetInt32(vr::k_pch_SteamVR_Section, vr::k_pch_SteamVR_SupersampleManualOverride_Bool, manual);
+		manualOverride = manual;
+		stale &= ~CachedState_ManualOverride;
+	}
+
+	bool pollExternalResolutionChange() override
+	{
+		getSupersampleScale();
+		return std::exchange(externalResolutionChange, false);
+	}
+
+	uint32_t getFrameTimings(vr::Compositor_FrameTiming *frameTimings, uint32_t count) override
+	{
+		return vr::VRCompositor()->GetFrameTimings(frameTimings, count);
+	}
+
+	float getDisplayFrequency() override
+	{
+		if (refresh(CachedState_DisplayFrequency))
+			displayFrequency = vr::VRSystem()->GetFloatTrackedDeviceProperty(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float);
+		return displayFrequency;
+	}
+
+	void getRecommendedRenderTargetSize(uint32_t *width, uint32_t *height) override
+	{
+		if (refresh(CachedState_RenderTargetSize))
+			vr::VRSystem()->GetRecommendedRenderTargetSize(&renderWidth, &renderHeight);
+		*width = renderWidth;
+		*height = renderHeight;
+	}
+
+	std::string getSceneApplicationKey() override
+	{
+		refreshSceneApplication();
+		return sceneApplicationKey;
+	}
+
+	uint32_t getSceneProcessId() override
+	{
+		refreshSceneApplication();
+		return sceneProcessId;
+	}
+
+	bool isDashboardVisible() override
+	{
+		if (refresh(CachedState_Dashboard))
+			dashboardVisible = vr::VROverlay()->IsDashboardVisible();
+		return dashboardVisible;
+	}
+
+	bool pollQuit() override
+	{
+		vr::VREvent_t vrEvent;
+		while (vr::VRSystem()->PollNextEvent(&vrEvent, sizeof(vr::VREvent_t)))
+		{
+			switch (vrEvent.eventType)
+			{
+			case vr::VREvent_Quit:
+				vr::VRSystem()->AcknowledgeQuit_Exiting();
+				return true;
+			case vr::VREvent_SceneApplicationChanged:
+			case vr::VREvent_SceneApplicationStateChanged:
+				stale |= CachedState_SceneApplication;
+				break;
+			case vr::VREvent_DashboardActivated:
+			case vr::VREvent_DashboardDeactivated:
+				stale |= CachedState_Dashboard;
+				break;
+			case vr::VREvent_TrackedDeviceActivated:
+			case vr::VREvent_PropertyChanged:
+				// The display frequency and render target size are properties of the HMD
+				if (vrEvent.trackedDeviceIndex == vr::k_unTrackedDeviceIndex_Hmd)
+					stale |= CachedState_DisplayFrequency | CachedState_RenderTargetSize;
+				break;
+			case vr::VREvent_SteamVRSectionSettingChanged:
+				// Resolution set by OVRDR or someone else
+				stale |= CachedState_SupersampleScale | CachedState_ManualOverride | CachedState_RenderTargetSize;
+				break;
+			}
+		}
+		return false;
+	}
+
+	int setAutoStart(bool enabled) override
+	{
+		return handle_setup(enabled);
+	}
+
+private:
+	/// Whether some cached state has to be read again (and counts it as read)
+	bool refresh(uint32_t state)
+	{
+		auto now = std::chrono::steady_clock::now();
+		if (now - staleTime >= cacheLifetime)
+		{
+			stale = CachedState_All;
+			staleTime = now;
+		}
+
+		if (!(stale & state))
+			return false;
+		stale &= ~state;
+		return true;
+	}
+
+	void refreshSceneApplication()
+	{
+		if (!refresh(CachedState_SceneApplication))
+			return;
+
+		sceneProcessId = vr::VRApplications()->GetCurrentSceneProcessId();
+		sceneApplicationKey.clear();
+		if (!sceneProcessId)
+			return;
+
+		char applicationKey[vr::k_unMaxApplicationKeyLength];
+		vr::EVRApplicationError err = vr::VRApplications()->GetApplicationKeyByProcessId(sceneProcessId, applicationKey, vr::k_unMaxApplicationKeyLength);
+		if (err)
+		{
+			// Not known yet while the application starts, asked again next time
+			stale |= CachedState_SceneApplication;
+			return;
+		}
+		sceneApplicationKey = applicationKey;
+	}
+
+	bool initialized = false;
+
+	uint32_t stale = CachedState_All;
+	// When everything was last marked stale
+	std::chrono::steady_clock::time_point staleTime;
+
+	float supersampleScale = 1.0f;
+	bool supersampleScaleKnown = false;
+	bool externalResolutionChange = false;
+	bool manualOverride = true;
+	float displayFrequency = 0;
+	uint32_t renderWidth = 0;
+	uint32_t renderHeight = 0;
+	uint32_t sceneProcessId = 0;
+	std::string sceneApplicationKey;
+	bool dashboardVisible = false;
+};
+
+std::unique_ptr<VrRuntime> createOpenVrRuntime()
+{
+	return std::make_unique<OpenVrRuntime>();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+// OpenVR structures
+#include <openvr.h>
+
+/**
+ * The parts of OpenVR OVRDR uses.
+ * Lets OVRDR run against a scripted fake runtime instead of SteamVR (--fake-vr).
+ * Getters are cheap enough to call every tick: state is cached and kept up to date by the events handled in pollQuit.
+ */
+class VrRuntime
+{
+public:
+	virtual ~VrRuntime() = default;
+
+	/// Returns an error message, or an empty string on success
+	virtual std::string init() = 0;
+	virtual void shutdown() = 0;
+
+	/// SteamVR resolution (1 = 100%)
+	virtual float getSupersampleScale() = 0;
+	virtual void setSupersampleScale(float scale) = 0;
+	/// Whether SteamVR's resolution is set to custom instead of auto
+	virtual bool getSupersampleManualOverride() = 0;
+	virtual void setSupersampleManualOverride(bool manual) = 0;
+	/// Whether SteamVR's resolution was changed by someone else (SteamVR settings, another app) since the last call
+	virtual bool pollExternalResolutionChange() = 0;
+
+	/// Latest frames, oldest first (like IVRCompositor::GetFrameTimings)
+	virtual uint32_t getFrameTimings(vr::Compositor_FrameTiming *frameTimings, uint32_t count) = 0;
+	/// HMD display frequency in hz
+	virtual float getDisplayFrequency() = 0;
+	/// Per-eye render target size at the current resolution
+	virtual void getRecommendedRenderTargetSize(uint32_t *width, uint32_t *height) = 0;
+	/// Current scene application key (steam.app.000000), empty if no app is running
+	virtual std::string getSceneApplicationKey() = 0;
+	/// Process of the current scene application, 0 if no app is running
+	virtual uint32_t getSceneProcessId() = 0;
+	virtual bool isDashboardVisible() = 0;
+
+	/// Handles pending events (updating the cached state), returns true (and acknowledges it) if the runtime is quitting
+	virtual bool pollQuit() = 0;
+
+	/// Enables or disables launching OVRDR with SteamVR, returns 0 or an error code
+	virtual int setAutoStart(bool enabled) = 0;
+};
+
+std::unique_ptr<VrRuntime> createOpenVrRuntime();
+
+/// Fake runtime playing the scenario file at scenarioPath (see README)
+std::unique_ptr<VrRuntime> createFakeVrRuntime(const std::string &scenarioPath);
@@ -0,0 +1,477 @@
+#include "vr_runtime.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "gpu_telemetry.hpp"
+#include "workload.hpp"
+
+// Frames kept for GetFrameTimings (like the compositor)
+static constexpr const int fakeFrameCount = 128;
+
+/// Something that happens at a given time in a scenario
+struct FakeVrEvent
+{
+	enum Type
+	{
+		App,
+		Dashboard,
+		Resolution,
+		Throttle,
+		Quit,
+	};
+
+	double time = 0;
+	Type type = Quit;
+	std::string appKey;
+	bool dashboardVisible = false;
+	bool throttled = false;
+	float supersampleScale = 1.0f;
+};
+
+/**
+ * VrRuntime rendering a simulated application in real time, scripted by a scenario file:
+ *
+ *   hz <hz>
+ *   render_target <width> <height>   (per eye at 100%)
+ *   vram <total GB> [GB used by other processes]
+ *   workload <steady|ramp|square|noisy|vram>
+ *   trace <trace.ovrt>
+ *   at <seconds> load <gpu ms per megapixel> [cpu ms]
+ *   at <seconds> app <app key|none>
+ *   at <seconds> dashboard <on|off>
+ *   at <seconds> res <percent|auto>   (set by someone else, auto turns off the manual override)
+ *   at <seconds> throttle <on|off>   (GPU clocks drop, frametimes go up)
+ *   at <seconds> quit
+ */
+class FakeVrRuntime : public VrRuntime
+{
+public:
+	explicit FakeVrRuntime(const std::string &scenarioPath) : scenarioPath(scenarioPath)
+	{
+	}
+
+	std::string init() override
+	{
+		std::string error = loadScenario();
+		if (!error.empty())
+			return error;
+		startTime = std::chrono::steady_clock::now();
+		return "";
+	}
+
+	void shutdown() override
+	{
+	}
+
+	float getSupersampleScale() override
+	{
+		return supersampleScale;
+	}
+
+	void setSupersampleScale(float scale) override
+	{
+		supersampleScale = scale;
+	}
+
+	bool getSupersampleManualOverride() override
+	{
+		return manualOverride;
+	}
+
+	void setSupersampleManualOverride(bool manual) override
+	{
+		manualOverride = manual;
+	}
+
+	bool pollExternalResolutionChange() override
+	{
+		update();
+		return std::exchange(externalResolutionChange, false);
+	}
+
+	uint32_t getFrameTimings(vr::Compositor_FrameTiming *frameTimings, uint32_t count) override
+	{
+		if (count == 0 || frameTimings[0].m_nSize != sizeof(vr::Compositor_FrameTiming))
+			return 0;
+
+		update();
+		uint32_t available = std::min<uint32_t>({count, (uint32_t)frames.size(), (uint32_t)fakeFrameCount});
+		for (uint32_t i = 0; i < available; i++)
+			frameTimings[i] = frames[frames.size() - available + i];
+		return available;
+	}
+
+	float getDisplayFrequency() override
+	{
+		return hz;
+	}
+
+	void getRecommendedRenderTargetSize(uint32_t *width, uint32_t *height) override
+	{
+		// Resolution scales the pixel count
+		float scale = std::sqrt(std::max(supersampleScale, 0.0f));
+		*width = (uint32_t)std::round(eyeWidth * scale);
+		*height = (uint32_t)std::round(eyeHeight * scale);
+	}
+
+	std::string getSceneApplicationKey() override
+	{
+		update();
+		return appKey;
+	}
+
+	uint32_t getSceneProcessId() override
+	{
+		update();
+		return appKey.empty() ? 0 : processId;
+	}
+
+	bool isDashboardVisible() override
+	{
+		update();
+		return dashboardVisible;
+	}
+
+	bool pollQuit() override
+	{
+		update();
+		return quit;
+	}
+
+	int setAutoStart(bool) override
+	{
+		return 0;
+	}
+
+	/// VRAM used by the simulated application and everything else
+	bool readGpu(GpuTelemetrySample &sample)
+	{
+		sample.vramTotalBytes = (uint64_t)(vramTotalGB * bytesPerGB);
+		sample.vramUsedBytes = std::min((uint64_t)((getAppVramGB() + vramOtherGB) * bytesPerGB), sample.vramTotalBytes);
+
+		// Busy rendering the frames still in the ring
+		double gpuTime = 0;
+		double frameTime = 0;
+		for (const vr::Compositor_FrameTiming &frame : frames)
+		{
+			gpuTime += frame.m_flTotalRenderGpuMs;
+			frameTime += frame.m_flClientFrameIntervalMs;
+		}
+		sample.utilization = frameTime > 0 ? (int)std::round(std::min(gpuTime / frameTime, 1.0) * 100.0) : 0;
+		sample.maxClockMHz = fakeMaxClockMHz;
+		sample.clockMHz = throttled ? (int)(fakeMaxClockMHz / throttleSlowdown) : fakeMaxClockMHz;
+		sample.throttled = throttled;
+		return true;
+	}
+
+	bool readProcessVram(uint32_t processId, uint64_t &vramUsedBytes)
+	{
+		if (processId != this->processId)
+			return false;
+		vramUsedBytes = (uint64_t)(getAppVramGB() * bytesPerGB);
+		return true;
+	}
+
+private:
+	std::string loadScenario()
+	{
+		std::ifstream file(scenarioPath);
+		if (!file)
+			return "Can't open VR scenario " + scenarioPath;
+
+		std::vector<WorkloadKeyframe> loads;
+		std::string line;
+		int lineNumber = 0;
+		while (std::getline(file, line))
+		{
+			lineNumber++;
+			line = line.substr(0, line.find('#'));
+			std::istringstream words(line);
+			std::string command;
+			if (!(words >> command))
+				continue;
+
+			bool valid = true;
+			if (command == "hz")
+			{
+				valid = (bool)(words >> hz) && hz > 0;
+			}
+			else if (command == "render_target")
+			{
+				valid = (bool)(words >> eyeWidth >> eyeHeight);
+			}
+			else if (command == "vram")
+			{
+				valid = (bool)(words >> vramTotalGB) && vramTotalGB > 0;
+				words >> vramOtherGB;
+			}
+			else if (command == "workload")
+			{
+				std::string name;
+				valid = (words >> name) && Workload::synthetic(name, workload);
+			}
+			else if (command == "trace")
+			{
+				std::string path;
+				valid = (words >> path) && Workload::fromTrace(path, megapixelsAt100(), workload);
+			}
+			else if (command == "at")
+			{
+				double time;
+				std::string type;
+				valid = (bool)(words >> time >> type);
+				if (valid && type == "load")
+				{
+					WorkloadKeyframe keyframe;
+					keyframe.time = time;
+					valid = (bool)(words >> keyframe.state.gpuMsPerMegapixel);
+					words >> keyframe.state.cpuMs;
+					// Loads hold until the next one
+					if (!loads.empty())
+						loads.push_back({time, loads.back().state});
+					loads.push_back(keyframe);
+				}
+				else if (valid && type == "app")
+				{
+					FakeVrEvent event;
+					event.time = time;
+					event.type = FakeVrEvent::App;
+					valid = (bool)(words >> event.appKey);
+					if (event.appKey == "none")
+						event.appKey = "";
+					events.push_back(event);
+				}
+				else if (valid && type == "dashboard")
+				{
+					FakeVrEvent event;
+					event.time = time;
+					event.type = FakeVrEvent::Dashboard;
+					std::string visible;
+					valid = (words >> visible) && (visible == "on" || visible == "off");
+					event.dashboardVisible = visible == "on";
+					events.push_back(event);
+				}
+				else if (valid && type == "res")
+				{
+					FakeVrEvent event;
+					event.time = time;
+					event.type = FakeVrEvent::Resolution;
+					std::string res;
+					valid = (bool)(words >> res);
+					// 0 for auto
+					event.supersampleScale = res == "auto" ? 0 : std::strtof(res.c_str(), nullptr) / 100.0f;
+					valid = valid && (res == "auto" || event.supersampleScale > 0);
+					events.push_back(event);
+				}
+				else if (valid && type == "throttle")
+				{
+					FakeVrEvent event;
+					event.time = time;
+					event.type = FakeVrEvent::Throttle;
+					std::string state;
+					valid = (words >> state) && (state == "on" || state == "off");
+					event.throttled = state == "on";
+					events.push_back(event);
+				}
+				else if (valid && type == "quit")
+				{
+					FakeVrEvent event;
+					event.time = time;
+					event.type = FakeVrEvent::Quit;
+					events.push_back(event);
+				}
+				else
+				{
+					valid = false;
+				}
+			}
+			else
+			{
+				valid = false;
+			}
+
+			if (!valid)
+				return scenarioPath + ":" + std::to_string(lineNumber) + ": invalid line \"" + line + "\"";
+		}
+
+		if (!loads.empty())
+		{
+			workload = Workload();
+			workload.name = "scenario";
+			workload.keyframes = loads;
+		}
+		std::stable_sort(events.begin(), events.end(), [](const FakeVrEvent &a, const FakeVrEvent &b)
+						 { return a.time < b.time; });
+		return "";
+	}
+
+	float megapixelsAt100() const
+	{
+		return 2.0f * eyeWidth * eyeHeight / 1000000.0f;
+	}
+
+	/// VRAM used by the simulated application at the current resolution
+	float getAppVramGB()
+	{
+		update();
+		if (appKey.empty())
+			return 0;
+		WorkloadState state = workload.at(nextFrameTime);
+		return std::max(state.vramFixedGB + state.vramGBPerMegapixel * megapixelsAt100() * supersampleScale, 0.0f);
+	}
+
+	/// Applies the scenario events and renders the frames up to now
+	void update()
+	{
+		double now = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+		while (nextEvent < events.size() && events[nextEvent].time <= now)
+		{
+			const FakeVrEvent &event = events[nextEvent++];
+			if (event.type == FakeVrEvent::App)
+			{
+				// Every application launched is a new process
+				appKey = event.appKey;
+				processId++;
+			}
+			else if (event.type == FakeVrEvent::Dashboard)
+				dashboardVisible = event.dashboardVisible;
+			else if (event.type == FakeVrEvent::Resolution && event.supersampleScale == 0)
+				manualOverride = false;
+			else if (event.type == FakeVrEvent::Resolution)
+			{
+				supersampleScale = event.supersampleScale;
+				externalResolutionChange = true;
+			}
+			else if (event.type == FakeVrEvent::Throttle)
+				throttled = event.throttled;
+			else
+				quit = true;
+		}
+
+		// Don't render more frames than can be fetched after a long pause
+		double refreshTime = 1.0 / hz;
+		nextFrameTime = std::max(nextFrameTime, now - fakeFrameCount * refreshTime);
+		while (nextFrameTime <= now)
+		{
+			WorkloadState state = workload.at(nextFrameTime);
+			float megapixels = megapixelsAt100() * supersampleScale;
+			float gpuTime = (state.gpuFixedMs + state.gpuMsPerMegapixel * megapixels) * std::max(1.0f + state.noise * gaussian(random), 0.1f);
+			if (throttled)
+				gpuTime *= throttleSlowdown;
+			// Frames that miss a refresh get reprojected
+			int presents = std::max((int)std::ceil(std::max(gpuTime, state.cpuMs) / (refreshTime * 1000.0) - 0.001), state.steamVrThrottling ? 2 : 1);
+
+			vr::Compositor_FrameTiming frame = {};
+			frame.m_nSize = sizeof(vr::Compositor_FrameTiming);
+			frame.m_nFrameIndex = ++frameIndex;
+			frame.m_nNumFramePresents = presents;
+			// Async reprojection is always on, the reasons tell what made the frame late (or how much SteamVR throttles the application)
+			frame.m_nReprojectionFlags = vr::VRCompositor_ReprojectionAsync;
+			if (presents > 1 && state.steamVrThrottling)
+				frame.m_nReprojectionFlags |= std::min(presents - 1, 15) << 8; // VRCompositor_ThrottleMask
+			else if (presents > 1)
+				frame.m_nReprojectionFlags |= gpuTime >= state.cpuMs ? vr::VRCompositor_ReprojectionReason_Gpu : vr::VRCompositor_ReprojectionReason_Cpu;
+			frame.m_flSystemTimeInSeconds = nextFrameTime;
+			frame.m_flTotalRenderGpuMs = gpuTime;
+			frame.m_flCompositorRenderGpuMs = compositorGpuMs;
+			frame.m_flSubmitFrameMs = submitFrameMs;
+			// CPU frametime = compositor + new frame ready - new poses ready
+			frame.m_flCompositorRenderCpuMs = compositorCpuMs;
+			frame.m_flNewPosesReadyMs = 1.0f;
+			frame.m_flNewFrameReadyMs = 1.0f + std::max(state.cpuMs - compositorCpuMs, 0.0f);
+			frame.m_flClientFrameIntervalMs = presents * refreshTime * 1000.0;
+
+			frames.push_back(frame);
+			if (frames.size() > fakeFrameCount)
+				frames.erase(frames.begin());
+			nextFrameTime += presents * refreshTime;
+		}
+	}
+
+	static constexpr const float compositorCpuMs = 0.5f;
+	static constexpr const float compositorGpuMs = 0.6f;
+	static constexpr const float submitFrameMs = 0.2f;
+	static constexpr const double bytesPerGB = 1073741824.0;
+	static constexpr const uint32_t firstFakeProcessId = 1000;
+	static constexpr const int fakeMaxClockMHz = 2000;
+	// GPU frametimes are this much longer while throttled
+	static constexpr const float throttleSlowdown = 1.3f;
+
+	std::string scenarioPath;
+	std::chrono::steady_clock::time_point startTime;
+
+	// Headset
+	float hz = 90.0f;
+	uint32_t eyeWidth = 2016;
+	uint32_t eyeHeight = 2240;
+	float vramTotalGB = 12.0f;
+	float vramOtherGB = 1.0f;
+
+	// Scenario
+	Workload workload;
+	std::vector<FakeVrEvent> events;
+	size_t nextEvent = 0;
+
+	// State
+	float supersampleScale = 1.0f;
+	bool manualOverride = true;
+	bool externalResolutionChange = false;
+	std::string appKey;
+	uint32_t processId = firstFakeProcessId;
+	bool dashboardVisible = false;
+	bool throttled = false;
+	bool quit = false;
+
+	// Rendering
+	std::vector<vr::Compositor_FrameTiming> frames;
+	double nextFrameTime = 0;
+	uint32_t frameIndex = 0;
+	std::mt19937 random{1};
+	std::normal_distribution<float> gaussian{0.0f, 1.0f};
+};
+
+/// GpuTelemetry reading the GPU simulated by a FakeVrRuntime
+class FakeGpuTelemetry : public GpuTelemetry
+{
+public:
+	explicit FakeGpuTelemetry(FakeVrRuntime &runtime) : runtime(runtime)
+	{
+	}
+
+	std::string getName() override
+	{
+		return "fake GPU";
+	}
+
+	bool read(GpuTelemetrySample &sample) override
+	{
+		return runtime.readGpu(sample);
+	}
+
+	bool readProcessVram(uint32_t processId, uint64_t &vramUsedBytes) override
+	{
+		return runtime.readProcessVram(processId, vramUsedBytes);
+	}
+
+private:
+	FakeVrRuntime &runtime;
+};
+
+std::unique_ptr<VrRuntime> createFakeVrRuntime(const std::string &scenarioPath)
+{
+	return std::make_unique<FakeVrRuntime>(scenarioPath);
+}
+
+std::unique_ptr<GpuTelemetry> createFakeGpuTelemetry(VrRuntime &fakeVrRuntime)
+{
+	return std::make_unique<FakeGpuTelemetry>(static_cast<FakeVrRuntime &>(fakeVrRuntime));
+}